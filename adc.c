@@ -0,0 +1,92 @@
+//  ==========================================================================================
+//  adc.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See adc.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "adc.h"
+#include "delay.h"
+
+uint8_t         adc_calFactor;
+uint16_t        adc_latencyUs;
+uint16_t        adc_calibrations;
+static uint8_t  adc_calibrated;
+
+// Time of one conversion in us (rounded up) for each sampling time setting: sampling time
+// plus 12.5 ADC cycles at 14 MHz.
+static const uint8_t adc_convUs[ 8 ] = { 1, 2, 2, 3, 4, 5, 6, 18 };
+
+
+//  ------------------------------------------------------------------------------------------
+//  adc_begin
+//  ------------------------------------------------------------------------------------------
+// Calibration must be done with the ADC disabled. Its result is left in the data register.
+// The stopwatch is only used within this function, so that delays can be used during the
+// burst. The first result follows ADRDY after exactly one conversion time.
+void
+adc_begin( uint8_t smp )
+{
+  delay_stopwatchStart();
+
+  RCC->APB2ENR |= RCC_APB2ENR_ADCEN;
+  RCC->CR2     |= RCC_CR2_HSI14ON;
+  while( !(RCC->CR2 & RCC_CR2_HSI14RDY) ) ;
+
+  if( !adc_calibrated )
+  {
+    ADC1->CR |= ADC_CR_ADCAL;
+    while( ADC1->CR & ADC_CR_ADCAL ) ;
+    adc_calFactor  = ADC1->DR & 0x7F;
+    adc_calibrated = 1;
+    adc_calibrations++;
+  }
+
+  ADC1->CFGR1 = ADC_CFGR1_AUTOFF | ADC_CFGR1_WAIT;          // Single conversion, 12 bits
+  ADC1->SMPR  = smp & ADC_SMPR_SMP;
+  ADC1->ISR   = ADC_ISR_ADRDY;
+  ADC1->CR   |= ADC_CR_ADEN;
+  while( !(ADC1->ISR & ADC_ISR_ADRDY) ) ;
+
+  adc_latencyUs = delay_stopwatchStop() + adc_convUs[ smp & 7 ];
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  adc_convert
+//  ------------------------------------------------------------------------------------------
+uint16_t
+adc_convert( uint8_t channel )
+{
+  ADC1->CHSELR = 1UL << channel;
+  ADC1->CR    |= ADC_CR_ADSTART;
+  while( !(ADC1->ISR & ADC_ISR_EOC) ) ;
+  return ADC1->DR;                                          // Also clears EOC
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  adc_end
+//  ------------------------------------------------------------------------------------------
+void
+adc_end( void )
+{
+  ADC1->CR |= ADC_CR_ADDIS;
+  while( ADC1->CR & ADC_CR_ADEN ) ;
+  RCC->CR2     &= ~RCC_CR2_HSI14ON;
+  RCC->APB2ENR &= ~RCC_APB2ENR_ADCEN;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  adc_recalibrate
+//  ------------------------------------------------------------------------------------------
+void
+adc_recalibrate( void )
+{
+  adc_calibrated = 0;
+}
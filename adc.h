@@ -0,0 +1,72 @@
+//  ==========================================================================================
+//  adc.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  ADC power sequencing.
+//
+//  The ADC runs from its own 14 MHz oscillator (HSI14). Leaving HSI14 and the ADC enabled
+//  between readings wastes current, and calibrating the ADC before every reading wastes
+//  time. Here conversions are done in bursts, between adc_begin() and adc_end():
+//    * HSI14 and the ADC are only powered during a burst. Between bursts the ADC is
+//      disabled, HSI14 is off and the ADC interface clock is gated.
+//    * Within a burst the ADC uses auto-off mode (AUTOFF), so its analog part is only
+//      powered while converting, and wait mode (WAIT), so no new conversion starts until
+//      the last result has been read.
+//    * The ADC is calibrated at the first adc_begin() only. The F030 keeps the calibration
+//      inside the ADC while it is disabled and through Sleep and Stop mode, but has no
+//      register to write it back, so it is lost in Standby (which restarts the firmware
+//      anyway) or when the ADC is reset. The factor found is kept in adc_calFactor for
+//      reference. Call adc_recalibrate() to calibrate again, e.g. after a large change in
+//      temperature or VDDA.
+//    * The time from calling adc_begin() to the first result of the burst is kept in
+//      adc_latencyUs. The power-up (HSI14 start, calibration if needed and ADC enable) is
+//      measured with the delay.h stopwatch, and the fixed time of one conversion is added.
+//
+//  As it uses TIM16 for the stopwatch, adc_begin() must not interrupt a delay in progress.
+//  The ADC is stopped in Stop mode, so a burst must not span a Stop.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __ADC_H
+#define __ADC_H
+
+#include "stm32f030x6.h"
+
+extern uint8_t  adc_calFactor;      // Calibration factor found by the last calibration
+extern uint16_t adc_latencyUs;      // Power-up to first result of the last burst, in us
+extern uint16_t adc_calibrations;   // Number of times the ADC has been calibrated
+
+
+//  ------------------------------------------------------------------------------------------
+//  void adc_begin( uint8_t smp )
+//  Powers HSI14 and the ADC for a burst of conversions, calibrating first if needed. smp is
+//  the sampling time setting for ADC1->SMPR (0 = 1.5 to 7 = 239.5 ADC cycles).
+//  ------------------------------------------------------------------------------------------
+void adc_begin( uint8_t smp );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint16_t adc_convert( uint8_t channel )
+//  Converts the given channel (0-9, 16 = temperature, 17 = VREFINT) and returns the 12-bit
+//  result. Only between adc_begin() and adc_end().
+//  ------------------------------------------------------------------------------------------
+uint16_t adc_convert( uint8_t channel );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void adc_end( void )
+//  Disables the ADC and turns off HSI14 and the ADC clock.
+//  ------------------------------------------------------------------------------------------
+void adc_end( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void adc_recalibrate( void )
+//  Calibrates again at the next adc_begin().
+//  ------------------------------------------------------------------------------------------
+void adc_recalibrate( void );
+
+#endif // __ADC_H
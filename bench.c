@@ -0,0 +1,413 @@
+//  ==========================================================================================
+//  bench.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See bench.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "bench.h"
+#include "clock.h"
+#include "uart.h"
+
+_Static_assert( ( BENCH_SAMPLES & ( BENCH_SAMPLES - 1 ) ) == 0 && BENCH_SAMPLES <= 4096,
+                "BENCH_SAMPLES must be a power of 2, up to 4096" );
+
+#define BENCH_LEAD      100         // Cycles from setting CCR1 to the edge
+#define BENCH_TIMEOUT   100000      // Busy-wait loops before giving up on an edge
+#define BENCH_VECTORS   48          // 16 system exceptions + 32 interrupts
+
+#define BENCH_RUN       0           // Busy waiting for the edge
+#define BENCH_SLEEP     1           // In Sleep mode when the edge arrives
+
+#define BENCH_PAIR      ( EXTI_PR_PR0 | EXTI_PR_PR1 )   // Raised together by software
+#define BENCH_DRAIN     0           // Both lines handled in one handler entry
+#define BENCH_REENTER   1           // One line per entry, the handler runs twice
+
+typedef struct
+{
+  uint16_t min;
+  uint16_t max;
+  uint32_t sum;
+} bench_result_t;
+
+typedef struct
+{
+  uint8_t mhz;
+  uint8_t waitStates;
+  uint8_t prefetch;
+  uint8_t ramVectors;
+} bench_config_t;
+
+// Copy of the vector table for MEM_MODE = SRAM, which maps 0x20000000 to address 0. The
+// linker script places the .ram_vector section at the start of RAM.
+static uint32_t bench_vectors[ BENCH_VECTORS ] __attribute__(( section(".ram_vector") ));
+
+static volatile uint16_t bench_latency;
+static volatile uint8_t  bench_done;
+static volatile uint8_t  bench_pairLeft;    // Lines of BENCH_PAIR not yet handled
+
+
+//  ------------------------------------------------------------------------------------------
+//  bench_irq
+//  ------------------------------------------------------------------------------------------
+void
+bench_irq( void )
+{
+  uint16_t cnt = TIM3->CNT;
+
+  bench_latency = cnt - TIM3->CCR1;
+  bench_done    = 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  Handlers for two lines pending at once
+//  ------------------------------------------------------------------------------------------
+// Installed as EXTI0_1_IRQHandler in the RAM vector table. bench_pairDrain() handles every
+// pending line in one entry and clears them with one write, as EXTI0_1_IRQHandler in main.c
+// does. bench_pairReenter() handles only one line per entry, as an "if ... else if" handler
+// would, so the second line makes the handler run again.
+static void
+bench_pairLine( void )
+{
+  if( !--bench_pairLeft )
+    bench_done = 1;
+}
+
+static void
+bench_pairDrain( void )
+{
+  uint32_t pending = EXTI->PR & BENCH_PAIR;
+
+  EXTI->PR = pending;
+  if( pending & EXTI_PR_PR0 )
+    bench_pairLine();
+  if( pending & EXTI_PR_PR1 )
+    bench_pairLine();
+}
+
+static void
+bench_pairReenter( void )
+{
+  if( EXTI->PR & EXTI_PR_PR0 )
+  {
+    EXTI->PR = EXTI_PR_PR0;
+    bench_pairLine();
+  }
+  else if( EXTI->PR & EXTI_PR_PR1 )
+  {
+    EXTI->PR = EXTI_PR_PR1;
+    bench_pairLine();
+  }
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  bench_clock
+//  ------------------------------------------------------------------------------------------
+// Always goes back to the HSI first, so that the PLL can be reconfigured and the wait
+// states changed safely. The wait states are raised before speeding up.
+static void
+bench_clock( const bench_config_t *c )
+{
+  RCC->CFGR = ( RCC->CFGR & ~RCC_CFGR_SW ) | RCC_CFGR_SW_HSI;
+  while( ( RCC->CFGR & RCC_CFGR_SWS ) != RCC_CFGR_SWS_HSI ) ;
+  RCC->CR &= ~RCC_CR_PLLON;
+  while( RCC->CR & RCC_CR_PLLRDY ) ;
+
+  FLASH->ACR = ( FLASH->ACR & ~( FLASH_ACR_LATENCY | FLASH_ACR_PRFTBE ) ) |
+               ( c->waitStates ? FLASH_ACR_LATENCY : 0 ) |
+               ( c->prefetch   ? FLASH_ACR_PRFTBE  : 0 );
+
+  if( c->mhz == 48 )
+  {
+    RCC->CFGR = ( RCC->CFGR & ~( RCC_CFGR_PLLSRC | RCC_CFGR_PLLMUL ) ) |
+                RCC_CFGR_PLLSRC_HSI_DIV2 | RCC_CFGR_PLLMUL12;
+    RCC->CR |= RCC_CR_PLLON;
+    while( !( RCC->CR & RCC_CR_PLLRDY ) ) ;
+    RCC->CFGR = ( RCC->CFGR & ~RCC_CFGR_SW ) | RCC_CFGR_SW_PLL;
+    while( ( RCC->CFGR & RCC_CFGR_SWS ) != RCC_CFGR_SWS_PLL ) ;
+  }
+
+  SYSCFG->CFGR1 = ( SYSCFG->CFGR1 & ~SYSCFG_CFGR1_MEM_MODE ) |
+                  ( c->ramVectors ? SYSCFG_CFGR1_MEM_MODE : 0 );
+
+  clock_update();
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  bench_sample
+//  ------------------------------------------------------------------------------------------
+// Returns the latency of one edge in cycles, or 0xFFFF if no edge arrived. Only the busy
+// wait can time out, so the sleeping measurement is only made once the loopback is known
+// to work.
+static uint16_t
+bench_sample( uint8_t mode )
+{
+  uint32_t timeout = BENCH_TIMEOUT;
+
+  bench_done = 0;
+  TIM3->CCR1 = (uint16_t)( TIM3->CNT + BENCH_LEAD );
+
+  if( mode == BENCH_SLEEP )
+    while( !bench_done )
+      __WFI();
+  else
+    while( !bench_done )
+      if( !--timeout )
+        return 0xFFFF;
+
+  return bench_latency;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  bench_measure
+//  ------------------------------------------------------------------------------------------
+static void
+bench_measure( bench_result_t *r, uint8_t mode )
+{
+  r->min = 0xFFFF;
+  r->max = 0;
+  r->sum = 0;
+
+  for( uint16_t n=0; n<BENCH_SAMPLES; n++ )
+  {
+    uint16_t latency = bench_sample( mode );
+    if( latency < r->min )
+      r->min = latency;
+    if( latency > r->max )
+      r->max = latency;
+    r->sum += latency;
+  }
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  bench_measurePair
+//  ------------------------------------------------------------------------------------------
+// Cycles from raising both lines of BENCH_PAIR with a single EXTI->SWIER store until the
+// main loop runs again, with the given handler in the RAM vector table.
+static void
+bench_measurePair( bench_result_t *r, uint8_t mode )
+{
+  bench_vectors[ 16 + EXTI0_1_IRQn ] = (uint32_t)( mode == BENCH_DRAIN ? bench_pairDrain :
+                                                                         bench_pairReenter );
+  r->min = 0xFFFF;
+  r->max = 0;
+  r->sum = 0;
+
+  for( uint16_t n=0; n<BENCH_SAMPLES; n++ )
+  {
+    bench_done     = 0;
+    bench_pairLeft = 2;
+    uint16_t start = TIM3->CNT;
+    EXTI->SWIER    = BENCH_PAIR;
+    while( !bench_done ) ;
+    uint16_t cycles = TIM3->CNT - start;
+
+    if( cycles < r->min )
+      r->min = cycles;
+    if( cycles > r->max )
+      r->max = cycles;
+    r->sum += cycles;
+  }
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  Output
+//  ------------------------------------------------------------------------------------------
+// Right-aligned in a column of the given width
+static void
+bench_putn( uint32_t value, uint8_t width )
+{
+  uint8_t digits = 1;
+
+  for( uint32_t v=value; v>=10; v/=10 )
+    digits++;
+  while( width-- > digits )
+    uart_putc( ' ' );
+  uart_putu( value );
+}
+
+// Average with one decimal, e.g. "  23.4"
+static void
+bench_putAvg( uint32_t sum )
+{
+  uint32_t tenths = ( sum * 10 + BENCH_SAMPLES / 2 ) / BENCH_SAMPLES;
+
+  bench_putn( tenths / 10, 4 );
+  uart_putc( '.' );
+  uart_putc( '0' + tenths % 10 );
+}
+
+static void
+bench_putResult( const bench_result_t *r )
+{
+  uart_puts( " |" );
+  bench_putn( r->min, 5 );
+  bench_putAvg( r->sum );
+  bench_putn( r->max, 5 );
+  bench_putn( r->max - r->min, 5 );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  bench_run
+//  ------------------------------------------------------------------------------------------
+void
+bench_run( void )
+{
+  static const uint8_t speeds[] = { 8, 48 };
+  bench_config_t config;
+  bench_result_t results[2];
+  uint32_t       acr   = FLASH->ACR;
+  uint32_t       cfgr1;
+  uint32_t       scr   = SCB->SCR;
+
+  // Vector table copy
+  RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+  cfgr1 = SYSCFG->CFGR1;
+  for( uint8_t x=0; x<BENCH_VECTORS; x++ )
+    bench_vectors[x] = ( (const uint32_t *)FLASH_BASE )[x];
+
+  // PA6 as TIM3_CH1 (AF1) output, PA7 as input on EXTI line 7, both edges
+  RCC->AHBENR   |= RCC_AHBENR_GPIOAEN;
+  GPIOA->OSPEEDR |= GPIO_OSPEEDR_OSPEEDR6;
+  GPIOA->AFR[0]  = ( GPIOA->AFR[0] & ~GPIO_AFRL_AFSEL6 ) | ( 1 << GPIO_AFRL_AFSEL6_Pos );
+  GPIOA->MODER   = ( GPIOA->MODER & ~( GPIO_MODER_MODER6 | GPIO_MODER_MODER7 ) ) |
+                   ( 0b10 << GPIO_MODER_MODER6_Pos );
+  SYSCFG->EXTICR[1] &= ~SYSCFG_EXTICR2_EXTI7;
+  EXTI->RTSR |= EXTI_RTSR_TR7;
+  EXTI->FTSR |= EXTI_FTSR_TR7;
+  EXTI->PR    = EXTI_PR_PR7;
+  EXTI->IMR  |= EXTI_IMR_MR7;
+  NVIC_SetPriority( EXTI4_15_IRQn, 0 );
+  NVIC_ClearPendingIRQ( EXTI4_15_IRQn );
+  NVIC_EnableIRQ( EXTI4_15_IRQn );
+
+  // TIM3 counting every cycle, toggling CH1 on compare
+  RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+  TIM3->PSC     = 0;
+  TIM3->ARR     = 0xFFFF;
+  TIM3->CCMR1   = ( 0b011 << TIM_CCMR1_OC1M_Pos );
+  TIM3->CCER    = TIM_CCER_CC1E;
+  TIM3->EGR     = TIM_EGR_UG;
+  TIM3->CR1     = TIM_CR1_CEN;
+
+  // Sleep mode, not Stop, and back to the main loop after each edge
+  SCB->SCR &= ~( SCB_SCR_SLEEPDEEP_Msk | SCB_SCR_SLEEPONEXIT_Msk );
+
+  uart_open( BENCH_BAUD );
+  uart_puts( "\nInterrupt latency in cycles, " );
+  uart_putu( BENCH_SAMPLES );
+  uart_puts( " samples each\n"
+             "                |         run         |        sleep\n"
+             "MHz WS  PF   VT |  min   avg  max  jit |  min   avg  max  jit\n" );
+  uart_close();
+
+  if( bench_sample( BENCH_RUN ) == 0xFFFF )
+  {
+    uart_open( BENCH_BAUD );
+    uart_puts( "No edge on PA7, connect PA6 to PA7\n" );
+    uart_close();
+  }
+  else
+    for( uint8_t s=0; s<sizeof( speeds ); s++ )
+      for( uint8_t ws=( speeds[s] > 24 ); ws<2; ws++ )
+        for( uint8_t pf=0; pf<2; pf++ )
+          for( uint8_t vt=0; vt<2; vt++ )
+          {
+            config.mhz        = speeds[s];
+            config.waitStates = ws;
+            config.prefetch   = pf;
+            config.ramVectors = vt;
+
+            bench_clock( &config );
+            bench_measure( &results[ BENCH_RUN ],   BENCH_RUN );
+            bench_measure( &results[ BENCH_SLEEP ], BENCH_SLEEP );
+
+            config.mhz = 8;                 // Report on the HSI
+            config.ramVectors = 0;
+            bench_clock( &config );
+
+            uart_open( BENCH_BAUD );
+            bench_putn( speeds[s], 3 );
+            bench_putn( ws, 3 );
+            uart_puts( pf ? "  on" : " off" );
+            uart_puts( vt ? "  RAM" : "  ROM" );
+            bench_putResult( &results[ BENCH_RUN ] );
+            bench_putResult( &results[ BENCH_SLEEP ] );
+            uart_putc( '\n' );
+            uart_close();
+          }
+
+  // Two lines on one interrupt at once, handled in one entry or one entry per line. Only
+  // software triggers are used, so this needs no wiring.
+  EXTI->PR   = BENCH_PAIR;
+  EXTI->IMR |= BENCH_PAIR;
+  NVIC_ClearPendingIRQ( EXTI0_1_IRQn );
+  NVIC_EnableIRQ( EXTI0_1_IRQn );
+
+  uart_open( BENCH_BAUD );
+  uart_puts( "\nTwo EXTI lines raised together, cycles until back in the main loop\n"
+             "                |      one entry      |   entry per line\n"
+             "MHz WS  PF   VT |  min   avg  max  jit |  min   avg  max  jit\n" );
+  uart_close();
+
+  for( uint8_t s=0; s<sizeof( speeds ); s++ )
+  {
+    config.mhz        = speeds[s];
+    config.waitStates = ( speeds[s] > 24 );
+    config.prefetch   = 1;
+    config.ramVectors = 1;
+
+    bench_clock( &config );
+    bench_measurePair( &results[ BENCH_DRAIN ],   BENCH_DRAIN );
+    bench_measurePair( &results[ BENCH_REENTER ], BENCH_REENTER );
+
+    config.mhz = 8;
+    config.ramVectors = 0;
+    bench_clock( &config );
+
+    uart_open( BENCH_BAUD );
+    bench_putn( speeds[s], 3 );
+    bench_putn( config.waitStates, 3 );
+    uart_puts( "  on  RAM" );
+    bench_putResult( &results[ BENCH_DRAIN ] );
+    bench_putResult( &results[ BENCH_REENTER ] );
+    uart_putc( '\n' );
+    uart_close();
+  }
+
+  // Clean up
+  NVIC_DisableIRQ( EXTI0_1_IRQn );
+  EXTI->IMR &= ~BENCH_PAIR;
+  EXTI->PR   = BENCH_PAIR;
+  NVIC_ClearPendingIRQ( EXTI0_1_IRQn );
+  bench_vectors[ 16 + EXTI0_1_IRQn ] = ( (const uint32_t *)FLASH_BASE )[ 16 + EXTI0_1_IRQn ];
+  NVIC_DisableIRQ( EXTI4_15_IRQn );
+  EXTI->IMR  &= ~EXTI_IMR_MR7;
+  EXTI->RTSR &= ~EXTI_RTSR_TR7;
+  EXTI->FTSR &= ~EXTI_FTSR_TR7;
+  EXTI->PR    = EXTI_PR_PR7;
+  NVIC_ClearPendingIRQ( EXTI4_15_IRQn );
+  TIM3->CR1     = 0;
+  RCC->APB1ENR &= ~RCC_APB1ENR_TIM3EN;
+  GPIOA->MODER &= ~GPIO_MODER_MODER6;
+  SCB->SCR      = scr;
+
+  config.mhz        = 8;
+  config.waitStates = 0;
+  config.prefetch   = 0;
+  config.ramVectors = 0;
+  bench_clock( &config );
+  FLASH->ACR    = acr;
+  SYSCFG->CFGR1 = cfgr1;
+}
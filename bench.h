@@ -0,0 +1,76 @@
+//  ==========================================================================================
+//  bench.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Interrupt latency and jitter benchmark across clock, flash and vector table settings.
+//
+//  How quickly a handler starts after its input changes depends on the system clock, the
+//  flash wait states and prefetch buffer (each instruction and vector fetched from flash may
+//  stall), where the vector table is, and what the CPU was doing when the edge arrived. This
+//  benchmark measures it on the chip itself:
+//    * TIM3 runs at the full timer clock (one count per CPU cycle) and toggles PA6 (TIM3_CH1)
+//      when the counter reaches CCR1. PA6 is wired to PA7, which raises EXTI line 7 on both
+//      edges.
+//    * The handler calls bench_irq(), which reads the counter first. The latency is the
+//      number of cycles from the compare match to that read.
+//    * Each configuration is measured BENCH_SAMPLES times while the main loop is busy
+//      waiting, and again while it is in Sleep mode (WFI), giving the minimum, average and
+//      maximum. The jitter is maximum - minimum.
+//    * The sweep covers SYSCLK at 8 MHz (HSI) and 48 MHz (PLL from HSI / 2), 0 or 1 flash
+//      wait states (1 is required at 48 MHz), the prefetch buffer off or on, and the vector
+//      table in flash or copied to the start of RAM and remapped to address 0 through
+//      SYSCFG->CFGR1 MEM_MODE.
+//    * The cost of two EXTI lines pending at once on one interrupt is measured too. EXTI
+//      lines 0 and 1 are raised together with a single EXTI->SWIER store, and the cycles
+//      until the main loop runs again are counted, at 8 and 48 MHz. This is done once with
+//      a handler that handles both lines in one entry, as EXTI0_1_IRQHandler in main.c
+//      does, and once with one that handles one line per entry, so that the handler is
+//      entered a second time. The handlers are put in the RAM vector table, and no wiring
+//      is needed. The debounce delay of the button handlers is not included.
+//    * The results are sent as text tables on USART1 TX, PA9 (pin 17) at BENCH_BAUD, 8N1,
+//      once the chip is back on the 8 MHz HSI.
+//
+//  The latencies include the output compare and EXTI input synchronization (a few cycles)
+//  and the fixed cost of the EXTI handler before it calls bench_irq(), so compare the
+//  configurations against each other rather than with the 16 cycles given by ARM for the
+//  Cortex-M0 itself. The handler code is always run from flash, only the vector moves.
+//
+//  Wire PA6 (pin 12) to PA7 (pin 13). If no edge arrives, the report says so and the
+//  sweep is skipped, but the two-line measurement is still made.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include "stm32f030x6.h"
+
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES   256         // Samples per configuration and mode, a power of 2
+#endif
+#ifndef BENCH_BAUD
+#define BENCH_BAUD      115200
+#endif
+
+#define BENCH_LINES     EXTI_PR_PR7     // EXTI lines used, for the handler in main.c
+
+
+//  ------------------------------------------------------------------------------------------
+//  void bench_run( void )
+//  Runs the sweep and sends the results. Call at the start of main(), while the chip is on
+//  the HSI and no other interrupts are enabled. Takes about 0.1 s. Returns with the
+//  chip back on the HSI, TIM3 off, PA6 and PA7 as inputs, and EXTI lines 0, 1 and 7 masked.
+//  ------------------------------------------------------------------------------------------
+void bench_run( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void bench_irq( void )
+//  Call from EXTI4_15_IRQHandler, as the first thing, when EXTI line 7 is pending.
+//  ------------------------------------------------------------------------------------------
+void bench_irq( void );
+
+#endif // __BENCH_H
@@ -0,0 +1,85 @@
+//  ==========================================================================================
+//  burst.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See burst.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "burst.h"
+
+volatile uint8_t burst_busy;
+static void (*burst_done)( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  burst_init
+//  ------------------------------------------------------------------------------------------
+void
+burst_init( void )
+{
+  RCC->AHBENR  |= RCC_AHBENR_GPIOAEN;
+  RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+
+  GPIOA->MODER  = (GPIOA->MODER & ~GPIO_MODER_MODER9) | (0b10 << GPIO_MODER_MODER9_Pos);
+  GPIOA->AFR[1] = (GPIOA->AFR[1] & ~GPIO_AFRH_AFSEL9) | (2 << GPIO_AFRH_AFSEL9_Pos);
+
+  // PWM mode 2 on channel 2 with preload, main output enabled.
+  TIM1->CCMR1 = (0b111 << TIM_CCMR1_OC2M_Pos) | TIM_CCMR1_OC2PE;
+  TIM1->CCER  = TIM_CCER_CC2E;
+  TIM1->BDTR  = TIM_BDTR_MOE;
+
+  NVIC_EnableIRQ( TIM1_BRK_UP_TRG_COM_IRQn );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  burst_start
+//  ------------------------------------------------------------------------------------------
+// The repetition counter is only loaded on an update event, so UG is generated (with URS
+// set, so that it does not raise UIF) to load RCR, PSC, ARR and CCR2 before starting. In
+// one-pulse mode the counter then stops at the update event that occurs when the
+// repetition counter has counted down to 0, i.e. after RCR+1 periods. A pulse as long as
+// the period would give CCR2 = 0, which holds the pin high for good.
+uint8_t
+burst_start( uint16_t psc, uint16_t period, uint16_t pulse, uint16_t count,
+             void (*done)( void ) )
+{
+  if( burst_busy || count == 0 || count > 256 || period < 2 || pulse >= period )
+    return 0;
+
+  burst_busy = 1;
+  burst_done = done;
+
+  TIM1->CR1  = TIM_CR1_URS | TIM_CR1_OPM;
+  TIM1->PSC  = psc;
+  TIM1->ARR  = period - 1;
+  TIM1->CCR2 = period - pulse;             // High from CCR2 to the end of the period
+  TIM1->RCR  = count - 1;
+  TIM1->EGR  = TIM_EGR_UG;
+  TIM1->SR   = 0;
+  TIM1->DIER = TIM_DIER_UIE;
+  TIM1->CR1 |= TIM_CR1_CEN;
+
+  return 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  burst_irq
+//  ------------------------------------------------------------------------------------------
+void
+burst_irq( void )
+{
+  if( TIM1->SR & TIM_SR_UIF )
+  {
+    TIM1->SR   = 0;
+    TIM1->DIER = 0;
+    burst_busy = 0;
+    if( burst_done )
+      burst_done();
+  }
+}
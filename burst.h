@@ -0,0 +1,60 @@
+//  ==========================================================================================
+//  burst.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Hardware pulse bursts on TIM1.
+//
+//  Sends a burst of 1 to 256 PWM pulses on PA9 (pin 17, TIM1_CH2) with a single interrupt at
+//  the end, instead of one interrupt per pulse. The TIM1 repetition counter counts the
+//  periods and one-pulse mode stops the counter after the last one, so the whole burst
+//  runs in hardware while the CPU sleeps. Typical uses: LED blink codes, buzzer chirps,
+//  sensor excitation pulses.
+//
+//  Each period starts low and goes high for the last `pulse` ticks (PWM mode 2), so the pin
+//  is left low once the timer stops.
+//
+//  TIM1_BRK_UP_TRG_COM_IRQHandler must call burst_irq().
+//
+//  Example: 3 flashes of 50 ms, one every 200 ms:
+//    burst_start( tconv_psc1kHz, 200, 50, 3, 0 );
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __BURST_H
+#define __BURST_H
+
+#include "stm32f030x6.h"
+
+extern volatile uint8_t burst_busy;         // 1 while a burst is running
+
+
+//  ------------------------------------------------------------------------------------------
+//  void burst_init( void )
+//  Sets up PA9 as TIM1_CH2 and enables the TIM1 update interrupt in the NVIC.
+//  ------------------------------------------------------------------------------------------
+void burst_init( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t burst_start( uint16_t psc, uint16_t period, uint16_t pulse, uint16_t count,
+//                       void (*done)( void ) )
+//  Starts a burst of `count` (1 to 256) periods of `period` ticks, each with a high pulse of
+//  `pulse` ticks, which must be less than `period` so that each period starts low and the
+//  pin is left low. The tick is set by the prescaler `psc`, e.g. tconv_psc1MHz or
+//  tconv_psc1kHz. `done` (may be 0) is called from the interrupt when the burst has ended.
+//  Returns 0 if a burst is already running or the arguments are out of range.
+//  ------------------------------------------------------------------------------------------
+uint8_t burst_start( uint16_t psc, uint16_t period, uint16_t pulse, uint16_t count,
+                     void (*done)( void ) );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void burst_irq( void )
+//  Call from TIM1_BRK_UP_TRG_COM_IRQHandler.
+//  ------------------------------------------------------------------------------------------
+void burst_irq( void );
+
+#endif // __BURST_H
@@ -0,0 +1,109 @@
+//  ==========================================================================================
+//  capture.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See capture.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "capture.h"
+#include "clock.h"
+
+volatile uint8_t  capture_done;
+capture_result_t  capture_result;
+
+// Pairs of { CCR1 (period), CCR2 (high time) }, written by DMA.
+static uint16_t   capture_buffer[ CAPTURE_SAMPLES ][ 2 ];
+static uint16_t   capture_psc;
+
+
+//  ------------------------------------------------------------------------------------------
+//  capture_init
+//  ------------------------------------------------------------------------------------------
+void
+capture_init( uint16_t psc )
+{
+  RCC->AHBENR  |= RCC_AHBENR_GPIOAEN | RCC_AHBENR_DMA1EN;
+  RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+
+  // PA6 as AF1 (TIM3_CH1)
+  GPIOA->MODER  = (GPIOA->MODER & ~GPIO_MODER_MODER6) | (0b10 << GPIO_MODER_MODER6_Pos);
+  GPIOA->AFR[0] = (GPIOA->AFR[0] & ~GPIO_AFRL_AFSEL6) | (1 << GPIO_AFRL_AFSEL6_Pos);
+
+  // PWM input: IC1 = TI1 rising, IC2 = TI1 falling, reset the counter on TI1FP1.
+  TIM3->CR1   = 0;
+  TIM3->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_CC2S_1;
+  TIM3->CCMR2 = 0;
+  TIM3->CCER  = TIM_CCER_CC1E | TIM_CCER_CC2E | TIM_CCER_CC2P;
+  TIM3->SMCR  = (0b101 << TIM_SMCR_TS_Pos) | (0b100 << TIM_SMCR_SMS_Pos);
+  TIM3->PSC   = psc;
+  TIM3->ARR   = 0xFFFF;
+
+  // DMA burst of 2 registers starting at CCR1 (register 13 counting from CR1)
+  TIM3->DCR   = (1 << TIM_DCR_DBL_Pos) | (13 << TIM_DCR_DBA_Pos);
+
+  DMA1_Channel4->CCR  = 0;
+  DMA1_Channel4->CPAR = (uint32_t)&TIM3->DMAR;
+  NVIC_EnableIRQ( DMA1_Channel4_5_IRQn );
+
+  capture_psc = psc;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  capture_start
+//  ------------------------------------------------------------------------------------------
+void
+capture_start( void )
+{
+  capture_done = 0;
+
+  DMA1_Channel4->CCR   = 0;
+  DMA1->IFCR           = DMA_IFCR_CGIF4;
+  DMA1_Channel4->CMAR  = (uint32_t)capture_buffer;
+  DMA1_Channel4->CNDTR = CAPTURE_SAMPLES * 2;
+  DMA1_Channel4->CCR   = DMA_CCR_MINC | DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 |
+                         DMA_CCR_TCIE | DMA_CCR_EN;
+
+  TIM3->SR    = 0;
+  TIM3->DIER  = TIM_DIER_CC1DE;
+  TIM3->CR1   = TIM_CR1_CEN;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  capture_irq
+//  ------------------------------------------------------------------------------------------
+// The first sample is discarded, since the counter was not reset at the start of its period.
+// The divisions are done once per batch rather than once per edge.
+void
+capture_irq( void )
+{
+  if( !(DMA1->ISR & DMA_ISR_TCIF4) )
+    return;
+
+  DMA1->IFCR         = DMA_IFCR_CGIF4;
+  DMA1_Channel4->CCR = 0;
+  TIM3->DIER         = 0;
+  TIM3->CR1          = 0;
+
+  uint32_t sumPeriod = 0;
+  uint32_t sumHigh   = 0;
+  for( uint8_t x=1; x<CAPTURE_SAMPLES; x++ )
+  {
+    sumPeriod += capture_buffer[x][0];
+    sumHigh   += capture_buffer[x][1];
+  }
+
+  if( sumPeriod )
+  {
+    uint32_t tickHz = clock_timer_hz / (capture_psc + 1);
+    capture_result.periodTicks  = sumPeriod / (CAPTURE_SAMPLES - 1);
+    capture_result.freqHz       = (uint64_t)tickHz * (CAPTURE_SAMPLES - 1) / sumPeriod;
+    capture_result.dutyPermille = (uint64_t)sumHigh * 1000 / sumPeriod;
+  }
+  capture_done = 1;
+}
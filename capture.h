@@ -0,0 +1,72 @@
+//  ==========================================================================================
+//  capture.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Frequency and duty cycle measurement with TIM3 PWM input mode and DMA.
+//
+//  Measuring a signal by taking an interrupt on every edge limits the frequency that can be
+//  measured and keeps the CPU busy. Here the signal on PA6 (pin 12, TIM3_CH1) is measured
+//  by TIM3 in PWM input mode:
+//    * Channel 1 captures the rising edges and resets the counter (slave reset mode), so
+//      CCR1 holds the length of the period that just ended.
+//    * Channel 2 captures the falling edges of the same input, so CCR2 holds the length of
+//      the high part of that period.
+//  On every rising edge, a DMA burst (TIM3->DCR / DMAR) copies both CCR1 and CCR2 into a
+//  buffer, without any CPU involvement. Only when the buffer of CAPTURE_SAMPLES periods is
+//  full does the DMA complete interrupt fire, and the frequency and duty cycle are then
+//  averaged over the whole batch.
+//
+//  The timer runs at the timer clock divided by (psc + 1). The longest period that can be
+//  measured is 65535 timer ticks, e.g. 8.2 ms (122 Hz) with psc = 0 at 8 MHz. With psc = 0,
+//  signals up to a few hundred kHz can be measured.
+//
+//  Uses DMA1 channel 4 (TIM3_CH1 request). DMA1_Channel4_5_IRQHandler must call
+//  capture_irq(). Timers do not run in Stop mode, so only use Run or Sleep mode.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+#include "stm32f030x6.h"
+
+#ifndef CAPTURE_SAMPLES
+#define CAPTURE_SAMPLES 16          // Periods per batch (the first one is discarded)
+#endif
+
+typedef struct
+{
+  uint32_t freqHz;                  // Average frequency over the batch
+  uint16_t dutyPermille;            // Average high time, in 1/1000 of the period
+  uint16_t periodTicks;             // Average period in timer ticks
+} capture_result_t;
+
+extern volatile uint8_t   capture_done;     // Set when a batch has completed
+extern capture_result_t   capture_result;   // Result of the last completed batch
+
+
+//  ------------------------------------------------------------------------------------------
+//  void capture_init( uint16_t psc )
+//  Sets up PA6, TIM3 in PWM input mode and DMA1 channel 4. psc sets the timer resolution.
+//  ------------------------------------------------------------------------------------------
+void capture_init( uint16_t psc );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void capture_start( void )
+//  Starts measuring a batch of CAPTURE_SAMPLES periods and returns immediately.
+//  capture_done is set and capture_result updated when the batch is complete.
+//  ------------------------------------------------------------------------------------------
+void capture_start( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void capture_irq( void )
+//  Call from DMA1_Channel4_5_IRQHandler. Stops the capture and computes the batch result.
+//  ------------------------------------------------------------------------------------------
+void capture_irq( void );
+
+#endif // __CAPTURE_H
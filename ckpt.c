@@ -0,0 +1,238 @@
+//  ==========================================================================================
+//  ckpt.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See ckpt.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "ckpt.h"
+
+_Static_assert( CKPT_MAX_BYTES % 4 == 0 && CKPT_MAX_BYTES <= 1016,
+                "CKPT_MAX_BYTES must be a multiple of 4 and leave room for one slot" );
+
+#define CKPT_PAGE_BYTES     1024
+#define CKPT_SLOT_WORDS     ( CKPT_MAX_BYTES / 4 + 2 )      // Header, data, CRC
+#define CKPT_SLOTS          ( CKPT_PAGE_BYTES / 4 / CKPT_SLOT_WORDS )
+#define CKPT_ERASED         0xFFFFFFFF
+
+// The flash page holding the slots. It is never initialized by the program (see the
+// .ckpt section in the linker script), and only read through volatile pointers, so that
+// the compiler does not assume it holds zeros.
+static const uint32_t ckpt_page[ CKPT_PAGE_BYTES / 4 ]
+                      __attribute__(( section(".ckpt"), aligned( CKPT_PAGE_BYTES ) ));
+
+static const ckpt_var_t *ckpt_vars;
+static uint8_t           ckpt_count;
+static uint16_t          ckpt_bytes;        // Total size of the variables
+static uint16_t          ckpt_layout;       // Signature of the table
+
+
+//  ------------------------------------------------------------------------------------------
+//  ckpt_slot, ckpt_crc
+//  ------------------------------------------------------------------------------------------
+static const volatile uint32_t *
+ckpt_slot( uint8_t n )
+{
+  return (const volatile uint32_t *)ckpt_page + n * CKPT_SLOT_WORDS;
+}
+
+// CRC-32 (polynomial 0x04C11DB7, initial value 0xFFFFFFFF) of the given words
+static uint32_t
+ckpt_crc( const volatile uint32_t *words, uint8_t count )
+{
+  CRC->CR = CRC_CR_RESET;
+  while( count-- )
+    CRC->DR = *words++;
+  return CRC->DR;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  ckpt_init
+//  ------------------------------------------------------------------------------------------
+uint8_t
+ckpt_init( const ckpt_var_t *vars, uint8_t count )
+{
+  uint32_t bytes = 0;
+
+  RCC->AHBENR |= RCC_AHBENR_CRCEN;
+
+  CRC->CR = CRC_CR_RESET;
+  CRC->DR = count;
+  for( uint8_t x=0; x<count; x++ )
+  {
+    CRC->DR = vars[x].size;
+    bytes  += vars[x].size;
+  }
+  ckpt_layout = (uint16_t)CRC->DR;
+
+  if( bytes > CKPT_MAX_BYTES )
+    return 0;
+  ckpt_vars  = vars;
+  ckpt_count = count;
+  ckpt_bytes = bytes;
+  return 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  ckpt_pack
+//  ------------------------------------------------------------------------------------------
+// Builds the record for the current values of the variables. The header holds the number
+// of bytes and the table signature, so it can never look like an erased word. Returns the
+// number of words in the record.
+static uint8_t
+ckpt_pack( uint32_t *record )
+{
+  uint8_t  words = ( ckpt_bytes + 3 ) / 4 + 1;
+  uint8_t *data  = (uint8_t *)&record[1];
+
+  record[words - 1] = 0;                    // Padding
+  record[0]         = ( (uint32_t)ckpt_bytes << 16 ) | ckpt_layout;
+  for( uint8_t x=0; x<ckpt_count; x++ )
+    for( uint16_t n=0; n<ckpt_vars[x].size; n++ )
+      *data++ = ( (const uint8_t *)ckpt_vars[x].addr )[n];
+  record[words] = ckpt_crc( record, words );
+  return words + 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  ckpt_newest
+//  ------------------------------------------------------------------------------------------
+// Returns the newest slot holding an intact record for this table, or -1 if there is none.
+// The slots are written in order, so this is the last one that checks out.
+static int8_t
+ckpt_newest( void )
+{
+  uint32_t header = ( (uint32_t)ckpt_bytes << 16 ) | ckpt_layout;
+  uint8_t  words  = ( ckpt_bytes + 3 ) / 4 + 1;
+
+  for( int8_t n=CKPT_SLOTS-1; n>=0; n-- )
+  {
+    const volatile uint32_t *slot = ckpt_slot( n );
+    if( slot[0] == header && slot[ words ] == ckpt_crc( slot, words ) )
+      return n;
+  }
+  return -1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  ckpt_restore
+//  ------------------------------------------------------------------------------------------
+uint8_t
+ckpt_restore( void )
+{
+  RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+  if( !( PWR->CSR & PWR_CSR_SBF ) )
+    return 0;
+  PWR->CR |= PWR_CR_CSBF;
+  if( !ckpt_vars )
+    return 0;
+
+  int8_t n = ckpt_newest();
+  if( n < 0 )
+    return 0;
+
+  const volatile uint8_t *data = (const volatile uint8_t *)&ckpt_slot( n )[1];
+  for( uint8_t x=0; x<ckpt_count; x++ )
+    for( uint16_t b=0; b<ckpt_vars[x].size; b++ )
+      ( (uint8_t *)ckpt_vars[x].addr )[b] = *data++;
+  return 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  Flash programming
+//  ------------------------------------------------------------------------------------------
+static void
+ckpt_wait( void )
+{
+  while( FLASH->SR & FLASH_SR_BSY ) ;
+  FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+}
+
+static void
+ckpt_erase( void )
+{
+  FLASH->CR |= FLASH_CR_PER;
+  FLASH->AR  = (uint32_t)ckpt_page;
+  FLASH->CR |= FLASH_CR_STRT;
+  __NOP();                                  // BSY is only set one cycle after STRT
+  ckpt_wait();
+  FLASH->CR &= ~FLASH_CR_PER;
+}
+
+// Flash is programmed a half-word at a time
+static void
+ckpt_program( const volatile uint32_t *slot, const uint32_t *record, uint8_t words )
+{
+  volatile uint16_t *dest = (volatile uint16_t *)slot;
+  const uint16_t    *src  = (const uint16_t *)record;
+
+  FLASH->CR |= FLASH_CR_PG;
+  for( uint8_t n=0; n<words*2; n++ )
+  {
+    dest[n] = src[n];
+    ckpt_wait();
+  }
+  FLASH->CR &= ~FLASH_CR_PG;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  ckpt_save
+//  ------------------------------------------------------------------------------------------
+// A slot is only free if it is completely erased, as a record cut short by a power failure
+// may have left any of its words programmed.
+uint8_t
+ckpt_save( void )
+{
+  uint32_t record[ CKPT_SLOT_WORDS ];
+  uint8_t  words;
+  int8_t   newest;
+  uint8_t  next = 0;
+
+  if( !ckpt_vars )
+    return 0;
+
+  words  = ckpt_pack( record );
+  newest = ckpt_newest();
+  if( newest >= 0 )
+  {
+    const volatile uint32_t *slot = ckpt_slot( newest );
+    uint8_t n = 0;
+    while( n < words && slot[n] == record[n] )
+      n++;
+    if( n == words )
+      return 0;                             // Unchanged
+  }
+
+  for( uint8_t s=0; s<CKPT_SLOTS; s++ )
+    for( uint8_t n=0; n<CKPT_SLOT_WORDS; n++ )
+      if( ckpt_slot( s )[n] != CKPT_ERASED )
+      {
+        next = s + 1;
+        break;
+      }
+
+  RCC->CR |= RCC_CR_HSION;                  // Flash programming runs from the HSI
+  while( !( RCC->CR & RCC_CR_HSIRDY ) ) ;
+
+  FLASH->KEYR = FLASH_KEY1;
+  FLASH->KEYR = FLASH_KEY2;
+  ckpt_wait();
+  if( next >= CKPT_SLOTS )
+  {
+    ckpt_erase();
+    next = 0;
+  }
+  ckpt_program( ckpt_slot( next ), record, words );
+  FLASH->CR |= FLASH_CR_LOCK;
+  return 1;
+}
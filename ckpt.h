@@ -0,0 +1,79 @@
+//  ==========================================================================================
+//  ckpt.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Checkpoint of application variables across Standby mode.
+//
+//  Standby mode clears the RAM, and the chip wakes up through a reset, so counters,
+//  calibration values and last readings are lost each time and must be rebuilt. Designs
+//  that need to keep them have to stay in Stop mode, which uses far more current. Instead,
+//  the variables to keep are listed in a table, and:
+//    * ckpt_save(), called just before entering Standby, packs them one after the other into
+//      a record with a CRC-32 from the hardware CRC unit, and writes it to flash.
+//    * ckpt_restore(), called at the start of main(), copies the newest record back into
+//      the variables if the chip is waking up from Standby (PWR_CSR_SBF set) and the record
+//      is intact. After a power-on or a reset from NRST the variables keep their initial
+//      values.
+//
+//  The STM32F030 has an RTC, but unlike larger STM32 parts it has no RTC backup registers
+//  (RTC_BKPxR) that keep their contents in Standby, so the records are kept in a 1 KB flash
+//  page of their own, placed after the program by the linker (the .ckpt section).
+//  The page is split into slots of CKPT_MAX_BYTES + 8 bytes, which are written in turn,
+//  and the page is only erased once all slots have been used. A record is only written
+//  when it differs from the last one, as the page may only be erased about 1000 times. With
+//  the default 8 slots, this allows about 8000 changed checkpoints, so do not register
+//  variables that change on every wake-up, such as a wake-up counter. If power fails while
+//  a record is being written, its CRC is wrong and the previous record is used.
+//
+//  Each record also holds a signature of the table (the number of variables and their
+//  sizes), so a record written by firmware with a different table is not restored. Flash
+//  writes need the HSI, which is turned on if needed, and stall the CPU (and any
+//  interrupts) for 20 to 40 ms for each page erase.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __CKPT_H
+#define __CKPT_H
+
+#include "stm32f030x6.h"
+
+#ifndef CKPT_MAX_BYTES
+#define CKPT_MAX_BYTES  120         // Most bytes of variables, a multiple of 4
+#endif
+
+typedef struct
+{
+  void     *addr;
+  uint16_t  size;
+} ckpt_var_t;
+
+// Table entry for a variable, e.g. static const ckpt_var_t vars[] = { CKPT_VAR( count ) };
+#define CKPT_VAR( var )     { &(var), sizeof( var ) }
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t ckpt_init( const ckpt_var_t *vars, uint8_t count )
+//  Sets the table of variables to keep. Returns 0 if they are more than CKPT_MAX_BYTES.
+//  ------------------------------------------------------------------------------------------
+uint8_t ckpt_init( const ckpt_var_t *vars, uint8_t count );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t ckpt_restore( void )
+//  Restores the variables if the chip has woken up from Standby. Returns 1 if they were
+//  restored, 0 if they keep their initial values.
+//  ------------------------------------------------------------------------------------------
+uint8_t ckpt_restore( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t ckpt_save( void )
+//  Writes the variables to flash if they have changed since the last record. Returns 1 if
+//  a record was written.
+//  ------------------------------------------------------------------------------------------
+uint8_t ckpt_save( void );
+
+#endif // __CKPT_H
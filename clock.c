@@ -0,0 +1,148 @@
+//  ==========================================================================================
+//  clock.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See clock.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "clock.h"
+#include "tconv.h"
+
+uint32_t clock_hz       = CLOCK_HSI_HZ;
+uint32_t clock_timer_hz = CLOCK_HSI_HZ;
+uint8_t  clock_source   = CLOCK_SRC_HSI;
+volatile uint16_t clock_cssFailures;
+
+
+//  ------------------------------------------------------------------------------------------
+//  clock_update
+//  ------------------------------------------------------------------------------------------
+// The AHB prescaler divides by 2, 4, 8, 16, 64, 128, 256 or 512 (no 32!), so the HPRE field
+// is turned into a shift count with a small table rather than a division.
+void
+clock_update( void )
+{
+  static const uint8_t hpreShift[8] = { 1, 2, 3, 4, 6, 7, 8, 9 };
+  uint32_t cfgr = RCC->CFGR;
+  uint32_t sysclk;
+
+  switch( cfgr & RCC_CFGR_SWS )
+  {
+    case RCC_CFGR_SWS_HSE:
+      sysclk       = CLOCK_HSE_HZ;
+      clock_source = CLOCK_SRC_HSE;
+      break;
+
+    case RCC_CFGR_SWS_PLL:
+    {
+      clock_source = CLOCK_SRC_PLL;
+      uint32_t mul = ((cfgr & RCC_CFGR_PLLMUL_Msk) >> RCC_CFGR_PLLMUL_Pos) + 2;
+      if( mul > 16 )                              // PLLMUL values 1110 and 1111 are both x16
+        mul = 16;
+      if( cfgr & RCC_CFGR_PLLSRC )                // HSE / PREDIV
+        sysclk = CLOCK_HSE_HZ / ((RCC->CFGR2 & RCC_CFGR2_PREDIV_Msk) + 1) * mul;
+      else                                        // HSI / 2
+        sysclk = (CLOCK_HSI_HZ >> 1) * mul;
+      break;
+    }
+
+    default:
+      sysclk       = CLOCK_HSI_HZ;
+      clock_source = CLOCK_SRC_HSI;
+      break;
+  }
+
+  uint32_t hpre = (cfgr & RCC_CFGR_HPRE_Msk) >> RCC_CFGR_HPRE_Pos;
+  clock_hz = (hpre & 0x8) ? sysclk >> hpreShift[ hpre & 0x7 ] : sysclk;
+
+  // Timers run at PCLK when the APB prescaler is 1, otherwise at twice PCLK.
+  uint32_t ppre = (cfgr & RCC_CFGR_PPRE_Msk) >> RCC_CFGR_PPRE_Pos;
+  clock_timer_hz = (ppre & 0x4) ? clock_hz >> ((ppre & 0x3) + 1) << 1 : clock_hz;
+
+  tconv_update( clock_hz, clock_timer_hz );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  clock_startHSE
+//  ------------------------------------------------------------------------------------------
+// Setting CSSON together with HSEON arms the clock security system as soon as the HSE is
+// ready; the hardware disarms it again whenever the HSE is stopped (e.g. in Stop mode).
+uint8_t
+clock_startHSE( void )
+{
+  uint8_t changed = 0;
+
+  if( (RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_PLL )
+    return 0;                                   // Already running from the PLL
+  if( clock_source != CLOCK_SRC_HSI )           // Woke from Stop on HSI
+  {
+    clock_update();
+    changed = 1;
+  }
+
+  RCC->CIR |= RCC_CIR_HSERDYC | RCC_CIR_PLLRDYC;
+  RCC->CIR |= RCC_CIR_HSERDYIE | RCC_CIR_PLLRDYIE;
+  NVIC_EnableIRQ( RCC_IRQn );
+  RCC->CR  |= RCC_CR_HSEON | RCC_CR_CSSON;
+
+  return changed;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  clock_irq
+//  ------------------------------------------------------------------------------------------
+uint8_t
+clock_irq( void )
+{
+  uint32_t cir = RCC->CIR;
+
+  if( cir & RCC_CIR_HSERDYF )                   // HSE is up: configure and start the PLL
+  {
+    RCC->CIR  |= RCC_CIR_HSERDYC;
+    RCC->CR   &= ~RCC_CR_PLLON;                 // PLL must be off to be configured
+    while( RCC->CR & RCC_CR_PLLRDY ) ;
+    RCC->CFGR2 = 0;                             // PREDIV = /1
+    RCC->CFGR  = (RCC->CFGR & ~(RCC_CFGR_PLLMUL | RCC_CFGR_PLLSRC)) |
+                 RCC_CFGR_PLLSRC_HSE_PREDIV | ((CLOCK_PLL_MUL - 2) << RCC_CFGR_PLLMUL_Pos);
+    RCC->CR   |= RCC_CR_PLLON;
+  }
+
+  if( cir & RCC_CIR_PLLRDYF )                   // PLL is locked: switch over
+  {
+    RCC->CIR |= RCC_CIR_PLLRDYC;
+
+    // One flash wait state is needed above 24 MHz. It must be set before the switch.
+    if( CLOCK_HSE_HZ * CLOCK_PLL_MUL > 24000000 )
+      FLASH->ACR = FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY;
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+    while( (RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL ) ;
+    clock_update();
+    return 1;
+  }
+
+  return 0;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  clock_nmi
+//  ------------------------------------------------------------------------------------------
+// On a CSS failure the hardware has already turned off the HSE and the PLL and selected the
+// HSI. The flash wait state is left as it is, since it is harmless at 8 MHz.
+uint8_t
+clock_nmi( void )
+{
+  if( !(RCC->CIR & RCC_CIR_CSSF) )
+    return 0;
+
+  RCC->CIR |= RCC_CIR_CSSC;                     // Clear the NMI
+  clock_cssFailures++;
+  clock_update();
+  return 1;
+}
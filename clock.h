@@ -0,0 +1,92 @@
+//  ==========================================================================================
+//  clock.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Keeps track of the current system clock frequency. Anything that depends on the clock
+//  speed (timer prescalers, tick to time conversions, delays) reads the values kept here
+//  instead of assuming the 8 MHz HSI default.
+//
+//  Call clock_update() once at startup and again every time the clock configuration in the
+//  RCC registers is changed.
+//
+//  HSE crystal with PLL:
+//    On boards with a crystal on PF0/PF1, clock_startHSE() switches the system clock to the
+//    PLL running from the HSE without waiting for the oscillators. It only turns on the HSE
+//    and returns; the HSE-ready and PLL-ready interrupts then finish the job from
+//    RCC_IRQHandler, which must call clock_irq(). The CPU keeps running (or sleeping) on the
+//    HSI in the meantime. If no crystal is fitted, the HSE never becomes ready and the chip
+//    simply stays on the HSI.
+//    The clock security system (CSS) is enabled along with the HSE. If the crystal fails,
+//    the hardware switches the system clock back to the HSI and raises an NMI, so
+//    NMI_Handler must call clock_nmi().
+//    Stop mode always wakes up on the HSI. Call clock_startHSE() again after waking up to
+//    restart the crystal in the background.
+//    The clock_startHSE(), clock_irq() and clock_nmi() functions return 1 whenever the
+//    system clock has changed, so that the caller can update anything that depends on it,
+//    such as timer prescalers or the SysTick reload value.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+#include "stm32f030x6.h"
+
+#define CLOCK_HSI_HZ  8000000UL     // Internal HSI oscillator frequency
+
+#ifndef CLOCK_HSE_HZ
+#define CLOCK_HSE_HZ  8000000UL     // External crystal frequency, if one is populated
+#endif
+
+#ifndef CLOCK_PLL_MUL
+#define CLOCK_PLL_MUL 6             // PLL multiplier for the HSE (8 MHz x 6 = 48 MHz)
+#endif
+
+#define CLOCK_SRC_HSI 0             // Values of clock_source
+#define CLOCK_SRC_HSE 1
+#define CLOCK_SRC_PLL 2
+
+extern uint32_t clock_hz;           // Current HCLK (core) frequency in Hz
+extern uint32_t clock_timer_hz;     // Current timer kernel clock frequency in Hz
+extern uint8_t  clock_source;       // Current system clock source (CLOCK_SRC_xxx)
+extern volatile uint16_t clock_cssFailures;   // Number of HSE failures caught by the CSS
+
+
+//  ------------------------------------------------------------------------------------------
+//  void clock_update( void )
+//  Reads the RCC configuration and recalculates clock_hz and clock_timer_hz. Also refreshes
+//  the precomputed tick conversion constants in tconv.
+//  ------------------------------------------------------------------------------------------
+void clock_update( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t clock_startHSE( void )
+//  Starts the HSE with the clock security system and enables the RCC interrupt that will
+//  switch over to the PLL once the oscillators are ready. Returns immediately. Returns 1 if
+//  the clock was found to have changed since the last call (i.e. after waking from Stop).
+//  ------------------------------------------------------------------------------------------
+uint8_t clock_startHSE( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t clock_irq( void )
+//  Call from RCC_IRQHandler. Configures and starts the PLL once the HSE is ready, and
+//  switches the system clock to the PLL once the PLL is locked. Returns 1 if the system
+//  clock was switched.
+//  ------------------------------------------------------------------------------------------
+uint8_t clock_irq( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t clock_nmi( void )
+//  Call from NMI_Handler. Handles a clock security system failure: the hardware has already
+//  switched back to the HSI, so this clears the flag and updates the clock values. Returns 1
+//  if a CSS failure was handled.
+//  ------------------------------------------------------------------------------------------
+uint8_t clock_nmi( void );
+
+#endif // __CLOCK_H
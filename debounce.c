@@ -0,0 +1,87 @@
+//  ==========================================================================================
+//  debounce.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See debounce.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "debounce.h"
+#include "wheel.h"
+
+volatile uint16_t    debounce_state;
+static uint16_t      debounce_pins;
+static uint16_t      debounce_cnt0, debounce_cnt1;    // Bits 0 and 1 of each pin's counter
+static debounce_fn_t debounce_changed;
+
+
+//  ------------------------------------------------------------------------------------------
+//  debounce_init
+//  ------------------------------------------------------------------------------------------
+void
+debounce_init( uint16_t pins, debounce_fn_t changed )
+{
+  RCC->AHBENR  |= RCC_AHBENR_GPIOAEN;
+  RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+  debounce_pins    = pins;
+  debounce_changed = changed;
+  debounce_cnt0    = 0;
+  debounce_cnt1    = 0;
+  debounce_state   = GPIOA->IDR & pins;
+
+  EXTI->RTSR |= pins;
+  EXTI->FTSR |= pins;
+  EXTI->PR    = pins;
+  EXTI->IMR  |= pins;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  debounce_tick
+//  ------------------------------------------------------------------------------------------
+// Counts 00 -> 01 -> 10 -> 11 -> 00 for each pin that differs from its debounced state, and
+// toggles the state when the counter wraps back to 00. Pins that match their state have
+// their counter cleared.
+//
+// When no counter is running, the EXTI lines are unmasked again. An edge between the last
+// sample and the unmasking would be lost, so the pins are read once more afterwards.
+static void
+debounce_tick( void )
+{
+  uint16_t delta  = ( GPIOA->IDR & debounce_pins ) ^ debounce_state;
+  debounce_cnt1   = ( debounce_cnt1 ^ debounce_cnt0 ) & delta;
+  debounce_cnt0   = ~debounce_cnt0 & delta;
+  uint16_t toggle = delta & ~( debounce_cnt0 | debounce_cnt1 );
+  debounce_state ^= toggle;
+
+  if( toggle && debounce_changed )
+    debounce_changed( toggle, debounce_state );
+
+  if( debounce_cnt0 | debounce_cnt1 )
+    return;
+
+  EXTI->PR   = debounce_pins;
+  EXTI->IMR |= debounce_pins;
+  if( ( GPIOA->IDR & debounce_pins ) != debounce_state )
+  {
+    EXTI->IMR &= ~debounce_pins;
+    return;
+  }
+  wheel_stop( WHEEL_ID_DEBOUNCE );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  debounce_exti
+//  ------------------------------------------------------------------------------------------
+void
+debounce_exti( void )
+{
+  EXTI->IMR &= ~debounce_pins;
+  EXTI->PR   = debounce_pins;
+  wheel_start( WHEEL_ID_DEBOUNCE, DEBOUNCE_TICK_MS, DEBOUNCE_TICK_MS, debounce_tick );
+}
@@ -0,0 +1,61 @@
+//  ==========================================================================================
+//  debounce.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Debouncing of any number of buttons on GPIOA at once, using vertical counters.
+//
+//  Debouncing each button in its own interrupt handler with a delay does not scale: every
+//  button adds code, and the delays of several buttons add up. Here all buttons are
+//  debounced together:
+//    * While all buttons are stable, the CPU sleeps and only the EXTI lines of the buttons
+//      are enabled, triggering on both edges.
+//    * On the first edge, the EXTI lines are masked and the whole GPIOA->IDR word is sampled
+//      every DEBOUNCE_TICK_MS by a wheel.h timer.
+//    * Each pin has a 2-bit counter. The bits of all counters are held "vertically" in two
+//      words, cnt0 and cnt1, so that all counters are updated at once with a few logic
+//      operations, no matter how many buttons there are. A counter runs while its pin
+//      differs from the debounced state, and is reset when the pin bounces back. After 4
+//      samples in a row that differ, the debounced state of the pin changes.
+//    * Once no counter is running, the timer is stopped and the EXTI lines are unmasked.
+//
+//  The pins are given as a mask of GPIOA pins. The EXTI lines with the same numbers are
+//  used, so the EXTI handlers for these lines (EXTI0_1, EXTI2_3 and/or EXTI4_15) must call
+//  debounce_exti(). Uses the WHEEL_ID_DEBOUNCE timer, so TIM17_IRQHandler must call
+//  wheel_irq(). The EXTI and TIM17 interrupts should have the same priority.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __DEBOUNCE_H
+#define __DEBOUNCE_H
+
+#include "stm32f030x6.h"
+
+#ifndef DEBOUNCE_TICK_MS
+#define DEBOUNCE_TICK_MS 5          // Sample period. A change is accepted after 4 samples.
+#endif
+
+// Called from the timer interrupt with the pins whose debounced state has just changed,
+// and the new debounced state of all pins.
+typedef void (*debounce_fn_t)( uint16_t changed, uint16_t state );
+
+extern volatile uint16_t debounce_state;    // Debounced state of the pins (1 = high)
+
+
+//  ------------------------------------------------------------------------------------------
+//  void debounce_init( uint16_t pins, debounce_fn_t changed )
+//  Sets up the EXTI lines of the given GPIOA pins for both edges. The pins must already
+//  be set up as inputs. changed is called whenever the debounced state changes.
+//  ------------------------------------------------------------------------------------------
+void debounce_init( uint16_t pins, debounce_fn_t changed );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void debounce_exti( void )
+//  Call from the EXTI handlers of the pins. Masks the lines and starts sampling.
+//  ------------------------------------------------------------------------------------------
+void debounce_exti( void );
+
+#endif // __DEBOUNCE_H
@@ -0,0 +1,142 @@
+//  ==========================================================================================
+//  delay.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See delay.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "delay.h"
+#include "tconv.h"
+
+
+//  ------------------------------------------------------------------------------------------
+//  delay_cycles
+//  ------------------------------------------------------------------------------------------
+// SUBS takes 1 cycle and a taken BNE 3 cycles on the Cortex-M0. Placed in .RamFunc (copied
+// to RAM by the startup code) so that the loop runs without flash wait states.
+__attribute__(( section(".RamFunc"), noinline ))
+void
+delay_cycles( uint32_t cycles )
+{
+  uint32_t loops = cycles >> 2;
+
+  if( loops )
+    __asm volatile( "1: subs %0, #1 \n"
+                    "   bne  1b     \n"
+                    : "+l" (loops) : : "cc" );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  delay_timer
+//  ------------------------------------------------------------------------------------------
+// Runs TIM16 once for `ticks` ticks (2 to 65536) of the given prescaler and sleeps until it
+// is done. URS is set so that the UG event that loads the prescaler does not set UIF.
+static void
+delay_timer( uint16_t psc, uint32_t ticks )
+{
+  uint32_t scr = SCB->SCR;
+
+  TIM16->CR1  = TIM_CR1_URS | TIM_CR1_OPM;
+  TIM16->PSC  = psc;
+  TIM16->ARR  = ticks - 1;                  // Counts 0 to ARR, then stops
+  TIM16->EGR  = TIM_EGR_UG;                 // Load PSC and clear the counter
+  TIM16->SR   = 0;
+  NVIC_ClearPendingIRQ( TIM16_IRQn );
+  TIM16->CR1 |= TIM_CR1_CEN;
+
+  SCB->SCR = (scr & ~SCB_SCR_SLEEPDEEP_Msk) | SCB_SCR_SEVONPEND_Msk;
+  while( !(TIM16->SR & TIM_SR_UIF) )        // Other events can also end the WFE early
+    __WFE();
+  SCB->SCR = scr;
+
+  TIM16->SR = 0;
+  NVIC_ClearPendingIRQ( TIM16_IRQn );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  delay_start
+//  ------------------------------------------------------------------------------------------
+static void
+delay_start( uint16_t psc, uint32_t ticks )
+{
+  RCC->APB2ENR |= RCC_APB2ENR_TIM16EN;
+  TIM16->DIER   = TIM_DIER_UIE;             // Pending request only; NVIC IRQ stays disabled
+
+  // Long delays are split so that the last part is still at least 2 ticks long.
+  while( ticks > 0x10000 )
+  {
+    delay_timer( psc, 0x8000 );
+    ticks -= 0x8000;
+  }
+  delay_timer( psc, ticks );
+
+  RCC->APB2ENR &= ~RCC_APB2ENR_TIM16EN;     // Stop clocking the timer between delays
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  delay_us
+//  ------------------------------------------------------------------------------------------
+void
+delay_us( uint32_t us )
+{
+  if( us < DELAY_SPIN_US )
+    delay_cycles( tconv_apply( us, tconv_usToCycles ) );
+  else
+    delay_start( tconv_psc1MHz, us );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  delay_ms
+//  ------------------------------------------------------------------------------------------
+// Short delays use the 1 us tick for better resolution.
+void
+delay_ms( uint32_t ms )
+{
+  if( ms == 0 )
+    return;
+  if( ms < 65 )
+    delay_start( tconv_psc1MHz, ms * 1000 );
+  else
+    delay_start( tconv_psc1kHz, ms );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  delay_stopwatchStart
+//  ------------------------------------------------------------------------------------------
+// Runs once from 0 to 0xFFFF, so that an overflow shows up as UIF instead of a wrap.
+void
+delay_stopwatchStart( void )
+{
+  RCC->APB2ENR |= RCC_APB2ENR_TIM16EN;
+  TIM16->CR1    = TIM_CR1_URS | TIM_CR1_OPM;
+  TIM16->DIER   = 0;
+  TIM16->PSC    = tconv_psc1MHz;
+  TIM16->ARR    = 0xFFFF;
+  TIM16->EGR    = TIM_EGR_UG;
+  TIM16->SR     = 0;
+  TIM16->CR1   |= TIM_CR1_CEN;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  delay_stopwatchStop
+//  ------------------------------------------------------------------------------------------
+uint16_t
+delay_stopwatchStop( void )
+{
+  uint16_t us = ( TIM16->SR & TIM_SR_UIF ) ? 0xFFFF : TIM16->CNT;
+
+  TIM16->CR1    = 0;
+  TIM16->SR     = 0;
+  RCC->APB2ENR &= ~RCC_APB2ENR_TIM16EN;
+  return us;
+}
@@ -0,0 +1,81 @@
+//  ==========================================================================================
+//  delay.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Calibrated delays that sleep while waiting.
+//
+//  A delay like "for( uint32_t x=0; x<33000; x++ ) ;" depends on the compiler optimization
+//  level and the clock speed, and keeps the CPU running at full current the whole time.
+//  Instead, delay_us() and delay_ms() start TIM16 in one-pulse mode and put the core to
+//  Sleep until the timer has run out.
+//
+//  How the wait works:
+//    TIM16 raises its update interrupt request when it runs out, but the TIM16 interrupt is
+//    left disabled in the NVIC, so no handler ever runs. Instead, the SEVONPEND bit in
+//    SCB->SCR makes any interrupt that becomes pending wake the core from WFE, even if the
+//    interrupt is disabled or has a lower priority than the code that is waiting. This means
+//    the delays can also be used inside interrupt handlers. SLEEPDEEP is cleared for the
+//    duration of the wait so that the core always uses Sleep mode (TIM16 would stop in
+//    Stop mode) and restored afterwards.
+//
+//  Waits shorter than DELAY_SPIN_US are not worth setting up the timer and sleeping for, and
+//  are done with a calibrated spin loop instead. The spin loop runs from RAM so that flash
+//  wait states do not change its timing: each pass takes exactly 4 core clock cycles.
+//
+//  TIM16 is used by this module and cannot be used for anything else. The delays are not
+//  reentrant: a delay in an interrupt handler must not preempt another delay in progress.
+//  TIM16 also provides a microsecond stopwatch for timing short operations; no delay may be
+//  used while it is running.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __DELAY_H
+#define __DELAY_H
+
+#include "stm32f030x6.h"
+
+#ifndef DELAY_SPIN_US
+#define DELAY_SPIN_US   10          // Shorter delays spin instead of sleeping
+#endif
+
+
+//  ------------------------------------------------------------------------------------------
+//  void delay_cycles( uint32_t cycles )
+//  Spins for approx. the given number of core clock cycles (rounded down to a multiple of
+//  4). For waits shorter than a microsecond.
+//  ------------------------------------------------------------------------------------------
+void delay_cycles( uint32_t cycles );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void delay_us( uint32_t us )
+//  Waits the given number of microseconds, sleeping unless the wait is very short.
+//  ------------------------------------------------------------------------------------------
+void delay_us( uint32_t us );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void delay_ms( uint32_t ms )
+//  Waits the given number of milliseconds in Sleep mode.
+//  ------------------------------------------------------------------------------------------
+void delay_ms( uint32_t ms );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void delay_stopwatchStart( void )
+//  Starts counting microseconds on TIM16.
+//  ------------------------------------------------------------------------------------------
+void delay_stopwatchStart( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint16_t delay_stopwatchStop( void )
+//  Stops the stopwatch and returns the microseconds since delay_stopwatchStart(), or 0xFFFF
+//  if 65.5 ms or more have passed.
+//  ------------------------------------------------------------------------------------------
+uint16_t delay_stopwatchStop( void );
+
+#endif // __DELAY_H
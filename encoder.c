@@ -0,0 +1,100 @@
+//  ==========================================================================================
+//  encoder.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See encoder.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "encoder.h"
+
+volatile uint8_t encoder_moved;
+static uint16_t  encoder_threshold;
+static uint16_t  encoder_last;              // Count at the previous encoder_read()
+
+
+//  ------------------------------------------------------------------------------------------
+//  encoder_arm
+//  ------------------------------------------------------------------------------------------
+// The counter moves by one count at a time, so it is bound to pass through CCR3 or CCR4
+// before it can get any further away. The 16-bit arithmetic wraps the same way as the
+// counter does.
+static void
+encoder_arm( uint16_t count )
+{
+  TIM3->CCR3 = (uint16_t)( count + encoder_threshold );
+  TIM3->CCR4 = (uint16_t)( count - encoder_threshold );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  encoder_init
+//  ------------------------------------------------------------------------------------------
+void
+encoder_init( uint16_t threshold )
+{
+  RCC->AHBENR  |= RCC_AHBENR_GPIOAEN;
+  RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+
+  // PA6 and PA7 as AF1 (TIM3_CH1, TIM3_CH2) with pullups
+  GPIOA->MODER  = (GPIOA->MODER & ~(GPIO_MODER_MODER6 | GPIO_MODER_MODER7)) |
+                  (0b10 << GPIO_MODER_MODER6_Pos) | (0b10 << GPIO_MODER_MODER7_Pos);
+  GPIOA->PUPDR  = (GPIOA->PUPDR & ~(GPIO_PUPDR_PUPDR6 | GPIO_PUPDR_PUPDR7)) |
+                  (0b01 << GPIO_PUPDR_PUPDR6_Pos) | (0b01 << GPIO_PUPDR_PUPDR7_Pos);
+  GPIOA->AFR[0] = (GPIOA->AFR[0] & ~(GPIO_AFRL_AFSEL6 | GPIO_AFRL_AFSEL7)) |
+                  (1 << GPIO_AFRL_AFSEL6_Pos) | (1 << GPIO_AFRL_AFSEL7_Pos);
+
+  // TI1 and TI2 as inputs with a filter of 8 samples, encoder mode 3 (count on both)
+  TIM3->CR1   = 0;
+  TIM3->CCMR1 = TIM_CCMR1_CC1S_0 | (0b0011 << TIM_CCMR1_IC1F_Pos) |
+                TIM_CCMR1_CC2S_0 | (0b0011 << TIM_CCMR1_IC2F_Pos);
+  TIM3->CCMR2 = 0;                          // CH3 and CH4 as plain compare (frozen output)
+  TIM3->CCER  = 0;
+  TIM3->SMCR  = 0b011 << TIM_SMCR_SMS_Pos;
+  TIM3->ARR   = 0xFFFF;
+  TIM3->CNT   = 0;
+
+  encoder_last      = 0;
+  encoder_moved     = 0;
+  encoder_threshold = threshold;
+
+  if( threshold )
+  {
+    encoder_arm( 0 );
+    TIM3->SR   = 0;
+    TIM3->DIER = TIM_DIER_CC3IE | TIM_DIER_CC4IE;
+    NVIC_EnableIRQ( TIM3_IRQn );
+  }
+
+  TIM3->CR1 = TIM_CR1_CEN;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  encoder_read
+//  ------------------------------------------------------------------------------------------
+int16_t
+encoder_read( void )
+{
+  uint16_t count = TIM3->CNT;
+  int16_t  delta = (int16_t)( count - encoder_last );
+
+  encoder_last  = count;
+  encoder_moved = 0;
+  return delta;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  encoder_irq
+//  ------------------------------------------------------------------------------------------
+void
+encoder_irq( void )
+{
+  TIM3->SR = 0;
+  encoder_arm( TIM3->CNT );
+  encoder_moved = 1;
+}
@@ -0,0 +1,60 @@
+//  ==========================================================================================
+//  encoder.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Quadrature rotary encoder input using the TIM3 encoder interface.
+//
+//  Decoding an encoder with EXTI interrupts wakes the CPU on every edge. Here the encoder's
+//  A and B outputs are connected to PA6 (pin 12, TIM3_CH1) and PA7 (pin 13, TIM3_CH2), and
+//  TIM3 counts up and down by itself in encoder mode while the CPU sleeps. Compare channels
+//  3 and 4 are set to the current count plus and minus a threshold, so the TIM3 interrupt
+//  only fires (and wakes the CPU) once the knob has been turned by at least that many
+//  counts in either direction.
+//
+//  Alternatively, leave the threshold at 0 to disable the interrupt, and call encoder_read()
+//  periodically, e.g. from a timer that is running anyway.
+//
+//  The encoder is decoded on both edges of both inputs (x4), so a typical detented encoder
+//  gives 4 counts per detent. The inputs have pullups and a digital filter of 8 timer clock
+//  cycles.
+//
+//  Note that timers do not run in Stop or Standby mode, so the encoder only counts while the
+//  chip is running or in Sleep mode. TIM3_IRQHandler must call encoder_irq().
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __ENCODER_H
+#define __ENCODER_H
+
+#include "stm32f030x6.h"
+
+extern volatile uint8_t encoder_moved;      // Set by encoder_irq() when threshold crossed
+
+
+//  ------------------------------------------------------------------------------------------
+//  void encoder_init( uint16_t threshold )
+//  Sets up PA6/PA7 and TIM3 in encoder mode. If threshold is not 0, the TIM3 interrupt is
+//  enabled and fires after the position has changed by that many counts.
+//  ------------------------------------------------------------------------------------------
+void encoder_init( uint16_t threshold );
+
+
+//  ------------------------------------------------------------------------------------------
+//  int16_t encoder_read( void )
+//  Returns the number of counts the encoder has moved since the previous call (positive
+//  clockwise) and clears encoder_moved. Must be called at least every 32767 counts.
+//  ------------------------------------------------------------------------------------------
+int16_t encoder_read( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void encoder_irq( void )
+//  Call from TIM3_IRQHandler. Re-arms the compare channels around the current count and
+//  sets encoder_moved.
+//  ------------------------------------------------------------------------------------------
+void encoder_irq( void );
+
+#endif // __ENCODER_H
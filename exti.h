@@ -0,0 +1,78 @@
+//  ==========================================================================================
+//  exti.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  EXTI interrupt handlers generated at compile time from a list of bindings.
+//
+//  The 16 EXTI lines share only three interrupts (lines 0-1, 2-3 and 4-15), so each handler
+//  has to find out which lines are pending and call the right code for each. A table of
+//  function pointers filled in at run time would do this generically, but costs a table
+//  load, an indirect call and a loop over all lines on every interrupt. Here the bindings
+//  are listed in a macro instead, and each handler is generated from it:
+//    * The pending lines are read once, masked with exactly the lines that are bound.
+//    * For each binding there is one test of a constant mask followed by the function,
+//      inlined if it is marked always_inline (see below) or else a direct call.
+//    * The handled lines are cleared with a single write to EXTI->PR, before the calls, so
+//      that an edge during a call is not lost.
+//    * It is a compile error (_Static_assert) to bind a line that is not on the handler's
+//      interrupt.
+//
+//  Usage, in the file that defines the functions (after them):
+//    #define KEY_LINES( X, a )  X( a, EXTI_PR_PR6 | EXTI_PR_PR7, keyEdge )
+//    EXTI_DEFINE_4_15( KEY_LINES )
+//  Each entry is X( a, lines, function ), where function is called once if any of the lines
+//  is pending and enabled in EXTI->IMR. Entries are usually put on their own line (see
+//  main.c). The "a" argument is used internally and must be passed through unchanged.
+//  Lines that are unmasked in EXTI->IMR but not bound would never be cleared, so only the
+//  bound lines may be unmasked.
+//  For the body of a function to be inlined into the handler, the function has to be
+//  defined before the list as
+//    static inline __attribute__(( always_inline )) void keyEdge( void ) { ... }
+//  main.c is built with -O0, where GCC inlines nothing that is not marked always_inline,
+//  so a plain static inline function is still a real call per binding. Functions in other
+//  files (such as bench_irq() in bench.c) are always called.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __EXTI_H
+#define __EXTI_H
+
+#include "stm32f030x6.h"
+
+// Lines on each of the three EXTI interrupts
+#define EXTI_LINES_0_1      0x0003
+#define EXTI_LINES_2_3      0x000C
+#define EXTI_LINES_4_15     0xFFF0
+
+
+//  ------------------------------------------------------------------------------------------
+//  Handler generation
+//  ------------------------------------------------------------------------------------------
+// Applied to each binding of the list
+#define EXTI_X_MASK( a, lines, fn )     | (lines)
+#define EXTI_X_CALL( a, lines, fn )     if( pending & (lines) ) fn();
+#define EXTI_X_CHECK( range, lines, fn )                                                    \
+  _Static_assert( ( (lines) & ~(range) ) == 0 && (lines) != 0,                              \
+                  "EXTI binding of " #fn " uses lines of another interrupt" );
+
+#define EXTI_DEFINE_HANDLER( handler, range, BINDINGS )                                     \
+  BINDINGS( EXTI_X_CHECK, range )                                                           \
+  void                                                                                      \
+  handler( void )                                                                           \
+  {                                                                                         \
+    uint32_t pending = EXTI->PR & EXTI->IMR & ( 0 BINDINGS( EXTI_X_MASK, ) );               \
+    EXTI->PR = pending;                                                                     \
+    BINDINGS( EXTI_X_CALL, )                                                                \
+  }
+
+#define EXTI_DEFINE_0_1( BINDINGS )   EXTI_DEFINE_HANDLER( EXTI0_1_IRQHandler,  \
+                                                           EXTI_LINES_0_1,  BINDINGS )
+#define EXTI_DEFINE_2_3( BINDINGS )   EXTI_DEFINE_HANDLER( EXTI2_3_IRQHandler,  \
+                                                           EXTI_LINES_2_3,  BINDINGS )
+#define EXTI_DEFINE_4_15( BINDINGS )  EXTI_DEFINE_HANDLER( EXTI4_15_IRQHandler, \
+                                                           EXTI_LINES_4_15, BINDINGS )
+
+#endif // __EXTI_H
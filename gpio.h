@@ -0,0 +1,92 @@
+//  ==========================================================================================
+//  gpio.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Atomic GPIO output functions.
+//
+//  Writing outputs with "GPIOA->ODR |= x" is a read-modify-write: the ODR is loaded,
+//  modified and stored back. If a higher priority interrupt changes another pin of the same
+//  port between the load and the store, its change is overwritten and lost. For example,
+//  the SysTick handler (priority 0) can preempt the TIM14 handler (priority 1) while it is
+//  flashing LED 2 and the SysTick's toggle of LED 3 is then undone.
+//
+//  The functions below use the BSRR (bit set/reset) and BRR (bit reset) registers instead.
+//  A single store to these registers changes only the pins whose bits are 1, so there is no
+//  window in which another pin can be lost, and it is also faster: one store instead of a
+//  load, an OR/AND and a store.
+//
+//  gpio_toggle() has to read the ODR to know which way to drive each pin, and then writes
+//  the result with a single BSRR store that both sets and resets only the toggled pins. A
+//  handler that toggled one of the same pins between the read and the store would have its
+//  change undone, so the read and the store are done with interrupts disabled (PRIMASK
+//  saved and restored, so it may be called from handlers and critical sections alike). This
+//  holds interrupts off for about 6 cycles.
+//
+//  The functions are always_inline, so that gpio_set() and gpio_clear() are a single store
+//  even in main.c, which is built without optimization and would otherwise call them.
+//  tests/gpio_test.c checks gpio_toggle() against a preempting interrupt ("make test").
+//
+//  The pins argument is a bit mask such as GPIO_ODR_3 | GPIO_ODR_4.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __GPIO_H
+#define __GPIO_H
+
+#include "stm32f030x6.h"
+
+
+//  ------------------------------------------------------------------------------------------
+//  void gpio_set( GPIO_TypeDef *port, uint32_t pins )
+//  Drives the given pins high.
+//  ------------------------------------------------------------------------------------------
+static inline __attribute__(( always_inline )) void
+gpio_set( GPIO_TypeDef *port, uint32_t pins )
+{
+  port->BSRR = pins;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  void gpio_clear( GPIO_TypeDef *port, uint32_t pins )
+//  Drives the given pins low.
+//  ------------------------------------------------------------------------------------------
+static inline __attribute__(( always_inline )) void
+gpio_clear( GPIO_TypeDef *port, uint32_t pins )
+{
+  port->BRR = pins;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  void gpio_write( GPIO_TypeDef *port, uint32_t pins, uint32_t value )
+//  Drives each of the given pins to the matching bit of value, in a single store.
+//  ------------------------------------------------------------------------------------------
+static inline __attribute__(( always_inline )) void
+gpio_write( GPIO_TypeDef *port, uint32_t pins, uint32_t value )
+{
+  port->BSRR = ((pins & ~value) << 16) | (pins & value);
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  void gpio_toggle( GPIO_TypeDef *port, uint32_t pins )
+//  Inverts the given pins. Pins that are high are reset and pins that are low are set, in a
+//  single BSRR store. No other handler can run between reading ODR and the store.
+//  ------------------------------------------------------------------------------------------
+static inline __attribute__(( always_inline )) void
+gpio_toggle( GPIO_TypeDef *port, uint32_t pins )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint32_t high = port->ODR & pins;
+  port->BSRR = (high << 16) | (pins & ~high);
+
+  __set_PRIMASK( primask );
+}
+
+#endif // __GPIO_H
@@ -0,0 +1,261 @@
+//  ==========================================================================================
+//  hsitrim.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See hsitrim.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "hsitrim.h"
+#include "clock.h"
+#include "adc.h"
+
+// Temperature sensor factory calibration value, measured at 30 C and VDDA = 3.3 V.
+#define TS_CAL1             (*(const uint16_t *)0x1FFFF7B8)
+
+// Temperature/trim pairs recorded by hsitrim_calibrate().
+static struct
+{
+  int16_t temp;
+  uint8_t trim;
+} hsitrim_points[ HSITRIM_POINTS ];
+static uint8_t hsitrim_pointCount;
+
+
+//  ------------------------------------------------------------------------------------------
+//  hsitrim_setTrim
+//  ------------------------------------------------------------------------------------------
+static void
+hsitrim_setTrim( int32_t trim )
+{
+  if( trim < 0 )
+    trim = 0;
+  if( trim > 31 )
+    trim = 31;
+  RCC->CR = (RCC->CR & ~RCC_CR_HSITRIM) | ((uint32_t)trim << RCC_CR_HSITRIM_Pos);
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  hsitrim_measure
+//  ------------------------------------------------------------------------------------------
+// Returns the number of timer ticks between the first capture and the capture that follows
+// `captures` more, or 0 on timeout or if an edge was missed. TIM14 is only 16 bits, so the
+// update flag is polled to extend the count. If a capture and an overflow are both pending,
+// a small capture value means the capture happened after the overflow.
+static uint32_t
+hsitrim_measure( uint16_t captures, uint32_t timeout )
+{
+  uint32_t high  = 0;
+  uint32_t first = 0;
+  uint16_t seen  = 0;
+
+  TIM14->SR = 0;
+  while( 1 )
+  {
+    uint32_t sr = TIM14->SR;
+
+    if( sr & TIM_SR_CC1IF )
+    {
+      uint32_t stamp = TIM14->CCR1;         // Reading CCR1 clears CC1IF
+      if( (sr & TIM_SR_UIF) && stamp < 0x8000 )
+        stamp += 0x10000;
+      stamp += high;
+
+      if( TIM14->SR & TIM_SR_CC1OF )        // Reference too fast to poll
+        return 0;
+      if( seen == 0 )
+        first = stamp;
+      else
+        if( seen == captures )
+          return stamp - first;
+      seen++;
+    }
+
+    if( sr & TIM_SR_UIF )
+    {
+      TIM14->SR = (uint32_t)~TIM_SR_UIF;    // rc_w0: clear only UIF
+      high += 0x10000;
+      if( high > timeout )
+        return 0;
+    }
+  }
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  hsitrim_calibrate
+//  ------------------------------------------------------------------------------------------
+int32_t
+hsitrim_calibrate( uint8_t ref, uint32_t refHz, uint16_t periods )
+{
+  // Above approx. 20 kHz, edges come too quickly to poll one by one, so use the /8 input
+  // capture prescaler and count every eighth edge.
+  uint8_t  pscShift = ( refHz > 20000 ) ? 3 : 0;
+  uint16_t captures = periods >> pscShift;
+  if( captures == 0 )
+    captures = 1;
+
+  uint32_t expected = (uint64_t)clock_timer_hz * ((uint32_t)captures << pscShift) / refHz;
+  uint32_t timeout  = expected << 1;
+
+  if( ref == HSITRIM_REF_PA7 )
+  {
+    RCC->AHBENR    |= RCC_AHBENR_GPIOAEN;
+    GPIOA->MODER    = (GPIOA->MODER & ~GPIO_MODER_MODER7) | (0b10 << GPIO_MODER_MODER7_Pos);
+    GPIOA->AFR[0]   = (GPIOA->AFR[0] & ~GPIO_AFRL_AFSEL7) | (4 << GPIO_AFRL_AFSEL7_Pos);
+  }
+
+  // Borrow TIM14 as a free running 16-bit counter with input capture on channel 1.
+  RCC->APB1ENR |= RCC_APB1ENR_TIM14EN;
+  uint32_t cr1   = TIM14->CR1,   dier = TIM14->DIER, psc  = TIM14->PSC,  arr = TIM14->ARR;
+  uint32_t ccmr1 = TIM14->CCMR1, ccer = TIM14->CCER, orr  = TIM14->OR,   cnt = TIM14->CNT;
+
+  TIM14->CR1   = 0;
+  TIM14->DIER  = 0;
+  TIM14->PSC   = 0;
+  TIM14->ARR   = 0xFFFF;
+  TIM14->OR    = ref;
+  TIM14->CCER  = 0;
+  TIM14->CCMR1 = TIM_CCMR1_CC1S_0 | ( pscShift ? TIM_CCMR1_IC1PSC : 0 );
+  TIM14->CCER  = TIM_CCER_CC1E;             // Capture on rising edges
+  TIM14->EGR   = TIM_EGR_UG;
+  TIM14->CR1   = TIM_CR1_CEN;
+
+  int32_t  trim      = (RCC->CR & RCC_CR_HSITRIM) >> RCC_CR_HSITRIM_Pos;
+  int32_t  bestTrim  = trim;
+  int32_t  bestError = HSITRIM_FAILED;
+
+  for( uint8_t pass=0; pass<HSITRIM_MAX_PASSES; pass++ )
+  {
+    uint32_t measured = hsitrim_measure( captures, timeout );
+    if( measured == 0 )
+      break;
+
+    int32_t error = (int64_t)((int32_t)(measured - expected)) * 1000000 / (int32_t)expected;
+    if( bestError == HSITRIM_FAILED || (error < 0 ? -error : error) <
+                                       (bestError < 0 ? -bestError : bestError) )
+    {
+      bestError = error;
+      bestTrim  = trim;
+    }
+
+    // A positive error means HSI is fast, which needs a lower trim value.
+    int32_t steps = ( error + (error < 0 ? -HSITRIM_STEP_PPM/2 : HSITRIM_STEP_PPM/2) )
+                    / HSITRIM_STEP_PPM;
+    if( steps == 0 || trim - steps < 0 || trim - steps > 31 )
+      break;
+    trim -= steps;
+    hsitrim_setTrim( trim );
+  }
+  hsitrim_setTrim( bestTrim );
+
+  TIM14->CR1   = 0;
+  TIM14->CCER  = 0;
+  TIM14->CCMR1 = ccmr1;
+  TIM14->CCER  = ccer;
+  TIM14->OR    = orr;
+  TIM14->PSC   = psc;
+  TIM14->ARR   = arr;
+  TIM14->EGR   = TIM_EGR_UG;                // Reload PSC
+  TIM14->CNT   = cnt;
+  TIM14->SR    = 0;
+  TIM14->DIER  = dier;
+  TIM14->CR1   = cr1;
+
+  if( bestError != HSITRIM_FAILED )
+  {
+    // Record the point, replacing one at the same temperature or else the oldest.
+    int16_t temp = hsitrim_readTemperature();
+    uint8_t slot = 0;
+    while( slot < hsitrim_pointCount && hsitrim_points[slot].temp != temp )
+      slot++;
+    if( slot == HSITRIM_POINTS )
+    {
+      for( slot=1; slot<HSITRIM_POINTS; slot++ )
+        hsitrim_points[slot-1] = hsitrim_points[slot];
+      slot = HSITRIM_POINTS - 1;
+    }
+    else
+      if( slot == hsitrim_pointCount )
+        hsitrim_pointCount++;
+    hsitrim_points[slot].temp = temp;
+    hsitrim_points[slot].trim = bestTrim;
+  }
+
+  return bestError;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  hsitrim_distance
+//  ------------------------------------------------------------------------------------------
+static int16_t
+hsitrim_distance( uint8_t point, int16_t temp )
+{
+  int16_t d = hsitrim_points[point].temp - temp;
+  return d < 0 ? -d : d;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  hsitrim_compensate
+//  ------------------------------------------------------------------------------------------
+// Picks the two recorded points closest in temperature and interpolates (or extrapolates)
+// the trim value linearly between them.
+void
+hsitrim_compensate( void )
+{
+  if( hsitrim_pointCount < 2 )
+    return;
+
+  int16_t temp = hsitrim_readTemperature();
+  uint8_t a = 0, b = 1;                     // a: closest point, b: second closest
+  if( hsitrim_distance( b, temp ) < hsitrim_distance( a, temp ) )
+  {
+    a = 1;
+    b = 0;
+  }
+  for( uint8_t x=2; x<hsitrim_pointCount; x++ )
+  {
+    if( hsitrim_distance( x, temp ) < hsitrim_distance( a, temp ) )
+    {
+      b = a;
+      a = x;
+    }
+    else
+      if( hsitrim_distance( x, temp ) < hsitrim_distance( b, temp ) )
+        b = x;
+  }
+
+  int32_t dT = hsitrim_points[b].temp - hsitrim_points[a].temp;
+  if( dT == 0 )
+    return;
+  int32_t num  = (int32_t)(temp - hsitrim_points[a].temp) *
+                 ((int32_t)hsitrim_points[b].trim - hsitrim_points[a].trim);
+  int32_t half = ( (num < 0) == (dT < 0) ) ? dT/2 : -dT/2;
+  hsitrim_setTrim( hsitrim_points[a].trim + (num + half) / dT );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  hsitrim_readTemperature
+//  ------------------------------------------------------------------------------------------
+// Single conversion of the internal temperature sensor (ADC channel 16). The ADC and HSI14
+// are powered only for the duration of the reading.
+// Temp = 30 C + ( TS_CAL1 - raw ) * 3300 mV / 4095 / 4.3 mV/C
+int16_t
+hsitrim_readTemperature( void )
+{
+  adc_begin( 7 );                                   // 239.5 cycles, approx. 17 us
+  ADC1_COMMON->CCR |= ADC_CCR_TSEN;
+  adc_convert( 16 );                                // First result covers sensor start-up
+  int32_t raw = adc_convert( 16 );
+  ADC1_COMMON->CCR &= ~ADC_CCR_TSEN;
+  adc_end();
+
+  return 30 + ( ((int32_t)TS_CAL1 - raw) * 33000 ) / ( 4095 * 43 );
+}
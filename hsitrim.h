@@ -0,0 +1,79 @@
+//  ==========================================================================================
+//  hsitrim.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  HSI calibration service.
+//
+//  Every period in this firmware assumes that the HSI runs at exactly 8 MHz, but the HSI is
+//  only factory trimmed to about 1% at 25 C and drifts further with temperature and supply
+//  voltage. This module measures the HSI against a known reference and adjusts the HSITRIM
+//  bits in RCC->CR so that the timers are closer to their nominal periods.
+//
+//  Measurement:
+//    TIM14 runs from the (HSI derived) timer clock and captures the rising edges of the
+//    reference on channel 1. The reference can be one of:
+//      HSITRIM_REF_PA7    An external reference pulse (GPS PPS, 1 kHz test signal, etc.)
+//                         on PA7 (pin 13), which is TIM14_CH1 in alternate function 4.
+//      HSITRIM_REF_HSE32  The HSE crystal divided by 32, routed internally to TIM14_CH1.
+//      HSITRIM_REF_MCO    Whatever is selected on the MCO, routed internally to TIM14_CH1.
+//    Note that the F030F4 has no LSE pins (PC14/PC15 are not bonded out on this package),
+//    so the LSE cannot be used as a reference.
+//    TIM14 is borrowed for the duration of the measurement; its registers are saved and
+//    restored, so the periodic TIM14 interrupt keeps working afterwards (with one period
+//    stretched by the measurement time).
+//    The system clock must be HSI (or PLL from HSI/2) while calibrating.
+//
+//  Temperature:
+//    Each successful calibration also records the chip temperature (internal sensor on ADC
+//    channel 16) together with the trim value found. Once two or more points at different
+//    temperatures have been recorded, hsitrim_compensate() reads the temperature and sets the
+//    trim predicted by interpolating between the recorded points, without needing the
+//    reference to be present. To collect the points, call hsitrim_calibrate() again
+//    whenever the reference may be present (main.c does so from the TIM14 interrupt); a
+//    new point replaces the one at the same temperature.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __HSITRIM_H
+#define __HSITRIM_H
+
+#include "stm32f030x6.h"
+
+#define HSITRIM_REF_PA7     0       // TIM14_CH1 from GPIO PA7
+#define HSITRIM_REF_HSE32   2       // TIM14_CH1 from HSE / 32
+#define HSITRIM_REF_MCO     3       // TIM14_CH1 from MCO
+
+#define HSITRIM_STEP_PPM    5000    // One HSITRIM step is approx. 40 kHz, or 0.5 %
+#define HSITRIM_MAX_PASSES  4       // Measure/adjust passes before giving up
+#define HSITRIM_POINTS      4       // Number of temperature/trim points remembered
+#define HSITRIM_FAILED      INT32_MIN
+
+
+//  ------------------------------------------------------------------------------------------
+//  int32_t hsitrim_calibrate( uint8_t ref, uint32_t refHz, uint16_t periods )
+//  Measures the HSI over the given number of reference periods, adjusts HSITRIM, and repeats
+//  until the error is less than half a trim step. Returns the remaining error in ppm, or
+//  HSITRIM_FAILED if the reference was missing or too fast to be captured.
+//  For a 1 kHz reference, 100 periods (100 ms) gives a resolution of 1.25 ppm.
+//  ------------------------------------------------------------------------------------------
+int32_t hsitrim_calibrate( uint8_t ref, uint32_t refHz, uint16_t periods );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void hsitrim_compensate( void )
+//  Reads the chip temperature and sets the trim predicted from the recorded calibration
+//  points. Does nothing until points at two different temperatures have been recorded.
+//  ------------------------------------------------------------------------------------------
+void hsitrim_compensate( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  int16_t hsitrim_readTemperature( void )
+//  Returns the chip temperature in degrees C, assuming VDDA = 3.3 V.
+//  ------------------------------------------------------------------------------------------
+int16_t hsitrim_readTemperature( void );
+
+#endif // __HSITRIM_H
@@ -0,0 +1,143 @@
+//  ==========================================================================================
+//  keypad.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See keypad.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "keypad.h"
+#include "gpio.h"
+#include "delay.h"
+#include "wheel.h"
+
+// Row pins, on any port
+static GPIO_TypeDef * const keypad_rowPort[ 4 ] = { GPIOA, GPIOA, GPIOA, GPIOB };
+static const uint8_t        keypad_rowPin[ 4 ]  = { 0, 1, 2, 1 };
+
+// Column pins, on GPIOA so that the EXTI line numbers match the pin numbers
+static const uint8_t        keypad_colPin[ 4 ]  = { 6, 7, 9, 10 };
+#define KEYPAD_COLS ( (1 << 6) | (1 << 7) | (1 << 9) | (1 << 10) )
+
+volatile uint16_t  keypad_keys;
+static keypad_fn_t keypad_changed;
+
+
+//  ------------------------------------------------------------------------------------------
+//  keypad_park
+//  ------------------------------------------------------------------------------------------
+// Drives all rows low, so that any key pulls its column low.
+static void
+keypad_park( void )
+{
+  for( uint8_t r=0; r<4; r++ )
+    gpio_clear( keypad_rowPort[r], 1 << keypad_rowPin[r] );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  keypad_init
+//  ------------------------------------------------------------------------------------------
+void
+keypad_init( keypad_fn_t changed )
+{
+  RCC->AHBENR  |= RCC_AHBENR_GPIOAEN | RCC_AHBENR_GPIOBEN;
+  RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+  keypad_changed = changed;
+  keypad_keys    = 0;
+
+  keypad_park();
+  for( uint8_t r=0; r<4; r++ )
+  {
+    GPIO_TypeDef *port = keypad_rowPort[r];
+    uint8_t       pin  = keypad_rowPin[r];
+    port->OTYPER |= 1 << pin;                               // Open drain
+    port->PUPDR  &= ~( 0b11 << (pin * 2) );                 // No pullup
+    port->MODER   = ( port->MODER & ~( 0b11 << (pin * 2) ) ) | ( 0b01 << (pin * 2) );
+  }
+  for( uint8_t c=0; c<4; c++ )
+  {
+    uint8_t pin = keypad_colPin[c];
+    GPIOA->MODER &= ~( 0b11 << (pin * 2) );                 // Input
+    GPIOA->PUPDR  = ( GPIOA->PUPDR & ~( 0b11 << (pin * 2) ) ) | ( 0b01 << (pin * 2) );
+  }
+
+  EXTI->FTSR |= KEYPAD_COLS;
+  EXTI->PR    = KEYPAD_COLS;
+  EXTI->IMR  |= KEYPAD_COLS;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  keypad_scan
+//  ------------------------------------------------------------------------------------------
+// Returns the keys that are pressed. Leaves all rows released.
+static uint16_t
+keypad_scan( void )
+{
+  uint16_t keys = 0;
+
+  for( uint8_t r=0; r<4; r++ )
+    gpio_set( keypad_rowPort[r], 1 << keypad_rowPin[r] );
+
+  for( uint8_t r=0; r<4; r++ )
+  {
+    uint16_t pin = 1 << keypad_rowPin[r];
+    gpio_clear( keypad_rowPort[r], pin );
+    delay_us( KEYPAD_SETTLE_US );
+    uint32_t idr = GPIOA->IDR;
+    gpio_set( keypad_rowPort[r], pin );
+
+    for( uint8_t c=0; c<4; c++ )
+      if( !( idr & ( 1 << keypad_colPin[c] ) ) )
+        keys |= 1 << ( r * 4 + c );
+  }
+  return keys;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  keypad_tick
+//  ------------------------------------------------------------------------------------------
+// When all keys have been released, the matrix is parked and the columns unmasked. A key
+// pressed just before unmasking would be missed, so the columns are checked once more.
+static void
+keypad_tick( void )
+{
+  uint16_t keys    = keypad_scan();
+  uint16_t changed = keys ^ keypad_keys;
+  keypad_keys      = keys;
+
+  if( changed && keypad_changed )
+    keypad_changed( changed & keys, keys );
+
+  if( keys )
+    return;
+
+  keypad_park();
+  delay_us( KEYPAD_SETTLE_US );
+  EXTI->PR   = KEYPAD_COLS;
+  EXTI->IMR |= KEYPAD_COLS;
+  if( ( GPIOA->IDR & KEYPAD_COLS ) != KEYPAD_COLS )
+  {
+    EXTI->IMR &= ~KEYPAD_COLS;
+    return;
+  }
+  wheel_stop( WHEEL_ID_KEYPAD );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  keypad_exti
+//  ------------------------------------------------------------------------------------------
+void
+keypad_exti( void )
+{
+  EXTI->IMR &= ~KEYPAD_COLS;
+  EXTI->PR   = KEYPAD_COLS;
+  wheel_start( WHEEL_ID_KEYPAD, KEYPAD_SCAN_MS, KEYPAD_SCAN_MS, keypad_tick );
+}
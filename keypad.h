@@ -0,0 +1,63 @@
+//  ==========================================================================================
+//  keypad.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Low-power 4x4 keypad matrix with EXTI wake-up.
+//
+//  A matrix needs only 8 pins for 16 keys, but is normally scanned continuously, which keeps
+//  the CPU awake. Here the matrix is only scanned while a key is held:
+//    * While idle, all 4 rows are driven low and the 4 columns are inputs with pullups and
+//      EXTI on the falling edge. No current flows until a key connects a column to a row,
+//      and the CPU sleeps until then.
+//    * The first edge masks the column EXTI lines and starts a wheel.h timer that scans the
+//      matrix every KEYPAD_SCAN_MS. Each scan releases all rows, then drives one row low at
+//      a time and reads the columns. Scanning at this rate also filters out contact bounce.
+//    * As soon as a scan finds no key pressed, the rows are driven low again, the timer is
+//      stopped and the column EXTI lines are unmasked.
+//
+//  Pins (change in keypad.c):
+//    Rows:    PA0 (pin 6), PA1 (pin 7), PA2 (pin 8), PB1 (pin 14), open-drain outputs
+//    Columns: PA6 (pin 12), PA7 (pin 13), PA9 (pin 17), PA10 (pin 18), with pullups
+//  The columns all share EXTI4_15_IRQHandler, which must call keypad_exti(). Uses the
+//  WHEEL_ID_KEYPAD timer, so TIM17_IRQHandler must call wheel_irq(). The EXTI and TIM17
+//  interrupts should have the same priority.
+//
+//  Key n (0-15) is bit n of the key masks, where n = row * 4 + column. Without diodes in the
+//  matrix, pressing 3 keys at the corners of a rectangle also shows the 4th as pressed.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __KEYPAD_H
+#define __KEYPAD_H
+
+#include "stm32f030x6.h"
+
+#ifndef KEYPAD_SCAN_MS
+#define KEYPAD_SCAN_MS   10         // Scan period while a key is held
+#endif
+#define KEYPAD_SETTLE_US 2          // Time for a column to be pulled back up between rows
+
+// Called from the timer interrupt when the keys have changed, with the keys that have just
+// been pressed and all keys that are now held.
+typedef void (*keypad_fn_t)( uint16_t pressed, uint16_t held );
+
+extern volatile uint16_t keypad_keys;       // Keys held at the last scan
+
+
+//  ------------------------------------------------------------------------------------------
+//  void keypad_init( keypad_fn_t changed )
+//  Sets up the row and column pins and the column EXTI lines, and parks the matrix.
+//  ------------------------------------------------------------------------------------------
+void keypad_init( keypad_fn_t changed );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void keypad_exti( void )
+//  Call from EXTI4_15_IRQHandler. Masks the columns and starts scanning.
+//  ------------------------------------------------------------------------------------------
+void keypad_exti( void );
+
+#endif // __KEYPAD_H
@@ -0,0 +1,201 @@
+//  ==========================================================================================
+//  load.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See load.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "load.h"
+#include "gpio.h"
+#include "wheel.h"
+
+uint32_t        load_onTime[ LOAD_MAX ];
+
+static const load_t *load_table;
+static uint8_t  load_count;
+static uint8_t  load_on;                    // Mask of powered loads
+static uint8_t  load_users[ LOAD_MAX ];     // Requests not yet released
+static uint32_t load_onAt[ LOAD_MAX ];      // wheel_now() at power-on
+
+static struct
+{
+  uint8_t   mask;
+  load_fn_t ready;                          // 0 for a free entry
+} load_batch[ LOAD_BATCHES ];
+
+
+//  ------------------------------------------------------------------------------------------
+//  load_power
+//  ------------------------------------------------------------------------------------------
+static void
+load_power( uint8_t id, uint8_t on )
+{
+  const load_t *load = &load_table[id];
+
+  gpio_write( load->port, load->pin, ( on ^ load->activeLow ) ? load->pin : 0 );
+  if( on )
+  {
+    load_on |= 1 << id;
+    load_onAt[id] = wheel_now();
+  }
+  else
+  {
+    load_on &= ~( 1 << id );
+    load_onTime[id] += wheel_now() - load_onAt[id];
+  }
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  load_tick
+//  ------------------------------------------------------------------------------------------
+// All of the work is done here, from the TIM17 interrupt: calling the batches that are
+// ready, turning off the loads that are no longer needed, and setting the timer for the
+// next of these events. Batches are handled first, as their ready functions usually
+// release loads.
+static void
+load_tick( void )
+{
+  uint8_t found = 0;
+  int32_t next  = 0;
+
+  for( uint8_t b=0; b<LOAD_BATCHES; b++ )
+  {
+    if( !load_batch[b].ready )
+      continue;
+
+    int32_t wait = 0;
+    for( uint8_t x=0; x<load_count; x++ )
+      if( load_batch[b].mask & ( 1 << x ) )
+      {
+        int32_t left = (int32_t)( load_onAt[x] + load_table[x].warmupMs - wheel_now() );
+        if( left > wait )
+          wait = left;
+      }
+
+    if( wait > 0 )
+    {
+      if( !found || wait < next )
+        next = wait;
+      found = 1;
+    }
+    else
+    {
+      load_fn_t ready = load_batch[b].ready;
+      load_batch[b].ready = 0;
+      ready();
+    }
+  }
+
+  for( uint8_t x=0; x<load_count; x++ )
+  {
+    if( !( load_on & ( 1 << x ) ) || load_users[x] )
+      continue;
+
+    int32_t left = (int32_t)( load_onAt[x] + load_table[x].minOnMs - wheel_now() );
+    if( left > 0 )
+    {
+      if( !found || left < next )
+        next = left;
+      found = 1;
+    }
+    else
+      load_power( x, 0 );
+  }
+
+  if( found )
+    wheel_start( WHEEL_ID_LOAD, next, 0, load_tick );
+  else
+    wheel_stop( WHEEL_ID_LOAD );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  load_init
+//  ------------------------------------------------------------------------------------------
+// The table is checked before anything is changed, as the per-load arrays only have
+// LOAD_MAX entries and the pin number search below needs exactly one bit set.
+uint8_t
+load_init( const load_t *loads, uint8_t count )
+{
+  load_count = 0;
+  if( count > LOAD_MAX )
+    return 0;
+  for( uint8_t x=0; x<count; x++ )
+    if( !loads[x].pin || ( loads[x].pin & ( loads[x].pin - 1 ) ) )
+      return 0;
+
+  load_table = loads;
+  load_count = count;
+
+  for( uint8_t x=0; x<count; x++ )
+  {
+    GPIO_TypeDef *port = loads[x].port;
+    uint8_t       pin  = 0;
+    while( !( loads[x].pin & ( 1 << pin ) ) )
+      pin++;
+
+    RCC->AHBENR |= ( port == GPIOA ) ? RCC_AHBENR_GPIOAEN :
+                   ( port == GPIOB ) ? RCC_AHBENR_GPIOBEN : RCC_AHBENR_GPIOFEN;
+    gpio_write( port, loads[x].pin, loads[x].activeLow ? loads[x].pin : 0 );   // Off
+    port->MODER = ( port->MODER & ~( 0b11 << (pin * 2) ) ) | ( 0b01 << (pin * 2) );
+  }
+  return 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  load_request
+//  ------------------------------------------------------------------------------------------
+uint8_t
+load_request( uint8_t mask, load_fn_t ready )
+{
+  uint8_t ok = 0;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  for( uint8_t b=0; b<LOAD_BATCHES && !ok; b++ )
+    if( !load_batch[b].ready )
+    {
+      load_batch[b].mask  = mask;
+      load_batch[b].ready = ready;
+      ok = 1;
+    }
+
+  if( ok )
+  {
+    for( uint8_t x=0; x<load_count; x++ )
+      if( mask & ( 1 << x ) )
+      {
+        load_users[x]++;
+        if( !( load_on & ( 1 << x ) ) )
+          load_power( x, 1 );
+      }
+    wheel_start( WHEEL_ID_LOAD, 0, 0, load_tick );
+  }
+
+  __set_PRIMASK( primask );
+  return ok;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  load_release
+//  ------------------------------------------------------------------------------------------
+void
+load_release( uint8_t mask )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  for( uint8_t x=0; x<load_count; x++ )
+    if( ( mask & ( 1 << x ) ) && load_users[x] )
+      load_users[x]--;
+  wheel_start( WHEEL_ID_LOAD, 0, 0, load_tick );
+
+  __set_PRIMASK( primask );
+}
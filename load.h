@@ -0,0 +1,77 @@
+//  ==========================================================================================
+//  load.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Power switching of external loads, such as sensors on a GPIO-switched supply rail.
+//
+//  An external sensor often draws more current than the sleeping MCU, so it should only be
+//  powered while it is needed. Each load is declared in a table with its power pin, the
+//  time it needs after power-on before it can be used (warm-up) and the shortest time it
+//  should stay on once powered (minimum on-time).
+//
+//  The application requests a batch of loads at once, as a mask of load numbers, along with
+//  a function to call when all of them are ready:
+//    * Loads in the batch that are off are all powered at the same time, so their warm-up
+//      times overlap instead of adding up.
+//    * The warm-up is timed by a wheel.h timer, so the CPU sleeps in the meantime.
+//    * When the slowest load of the batch has warmed up, the function is called. It reads
+//      the sensors and releases the loads with load_release().
+//    * A released load is turned off as soon as no batch needs it, but not before its
+//      minimum on-time. A request that arrives while a load is still on (e.g. from another
+//      part of the application) reuses it without another warm-up.
+//
+//  Uses the WHEEL_ID_LOAD timer, so TIM17_IRQHandler must call wheel_irq(). The ready
+//  functions are called from the TIM17 interrupt.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __LOAD_H
+#define __LOAD_H
+
+#include "stm32f030x6.h"
+
+#define LOAD_MAX       8            // Loads per table, as loads are given as 8-bit masks
+#define LOAD_BATCHES   4            // Requests that can be waiting at the same time
+
+typedef struct
+{
+  GPIO_TypeDef *port;               // Power switch pin
+  uint16_t      pin;                // e.g. GPIO_ODR_1
+  uint8_t       activeLow;          // 1 if the pin is driven low to power the load
+  uint16_t      warmupMs;           // Time from power-on until the load can be used
+  uint16_t      minOnMs;            // Shortest time to stay powered
+} load_t;
+
+typedef void (*load_fn_t)( void );
+
+extern uint32_t load_onTime[ LOAD_MAX ];    // Total time each load has been powered, in ms
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t load_init( const load_t *loads, uint8_t count )
+//  Sets up the power pins of the loads in the table (which must stay valid) and turns all
+//  loads off. Returns 0, and uses no loads, if there are more than LOAD_MAX of them or a
+//  pin is not exactly one bit.
+//  ------------------------------------------------------------------------------------------
+uint8_t load_init( const load_t *loads, uint8_t count );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t load_request( uint8_t mask, load_fn_t ready )
+//  Powers the loads in mask (bit n = load n) and calls ready once all of them have warmed
+//  up. The loads stay on until released. Returns 0 if too many requests are waiting.
+//  ------------------------------------------------------------------------------------------
+uint8_t load_request( uint8_t mask, load_fn_t ready );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void load_release( uint8_t mask )
+//  Ends one request for each load in mask. Loads that are no longer requested are turned
+//  off once their minimum on-time has passed.
+//  ------------------------------------------------------------------------------------------
+void load_release( uint8_t mask );
+
+#endif // __LOAD_H
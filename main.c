@@ -57,6 +57,30 @@
 //  ==========================================================================================
 
 #include "stm32f030x6.h"
+#include "clock.h"
+#include "tconv.h"
+#include "hsitrim.h"
+#include "gpio.h"
+#include "marker.h"
+#include "exti.h"
+#include "delay.h"
+#include "burst.h"
+#include "encoder.h"
+#include "pulse.h"
+#include "capture.h"
+#include "wheel.h"
+#include "debounce.h"
+#include "keypad.h"
+#include "touch.h"
+#include "load.h"
+#include "scan.h"
+#include "telem.h"
+#include "sched.h"
+#include "prio.h"
+#include "wake.h"
+#include "trace.h"
+#include "bench.h"
+#include "ckpt.h"
 
 //  ==========================================================================================
 //  Summary of Sleep Modes
@@ -129,6 +153,35 @@
  #define __SLEEP_MODE
 
 
+//  __WAKE_ATTRIBUTION
+//    Records which interrupt woke the chip each time, and whether its handler did any work
+//    (each handler calls WAKE_POST() when it did). The counts are kept in wake_count[] and
+//    wake_spurious[], indexed by IRQn, and can be read with the debugger. Interrupts listed
+//    in WAKE_MASKABLE are disabled once they have woken the chip 16 times in a row without
+//    doing any work. Not used in Standby mode, which wakes up through a reset. See wake.h
+//    for details.
+
+// #define __WAKE_ATTRIBUTION
+#define WAKE_MASKABLE 0             // e.g. ( 1UL << EXTI2_3_IRQn ) for an unused, noisy input
+
+// Compiles to nothing when not in use, so the handlers do not pay for it
+#ifdef __WAKE_ATTRIBUTION
+#define WAKE_POST()   wake_post()
+#else
+#define WAKE_POST()   ( (void)0 )
+#endif
+
+
+//  __CHECKPOINT
+//    For __STANDBY_MODE. Saves the variables listed in ckptVars[] (below main) to flash just
+//    before each Standby, if they have changed, and restores them at the start of main()
+//    after waking up from Standby, so they survive even though Standby clears the RAM. Here
+//    these are the LED pattern and, with __HSI_CALIBRATION, the HSI trim value, so that
+//    the 100 ms calibration is only run after a power-on or reset. See ckpt.h for details.
+
+// #define __CHECKPOINT
+
+
 //  ==========================================================================================
 //  Interrupt Defines
 //  Comment out the define to set up and run the desired type of interrupt. Multiple
@@ -154,11 +207,288 @@
 //    clock cycles have occurred, where x is a 24-bit number initialized in the
 //    SysTick_Config( x ) procedure. On an 8 MHz clock, the slowest time between calls to the
 //    interrupt handler is approx. 2 seconds when using a value of (uint32_t)16E6 for x.
+//
+//  __BURST_OUTPUT
+//    An additional LED (with 1K resistor) on PA9 (pin 17) is flashed 3 times each time the
+//    TIM14 interrupt fires. The flashes are generated by TIM1 in hardware and only one
+//    interrupt (TIM1_BRK_UP_TRG_COM_IRQHandler) occurs at the end of the burst. Requires
+//    __TIMER_INTERRUPT. See burst.h for details.
+//
+//  __ENCODER_INTERRUPT
+//    A quadrature rotary encoder on PA6 (pin 12) and PA7 (pin 13) is counted by TIM3 in
+//    hardware. TIM3_IRQHandler is only called after the knob has been turned by one detent
+//    (4 counts): turning clockwise turns ON the PA3 LED, counterclockwise turns it OFF.
+//    Only works in Sleep mode, as TIM3 is stopped in Stop mode. See encoder.h for details.
+//
+//  __PULSE_COUNTER
+//    Pulses on PA6 (pin 12), e.g. from a flow meter, clock TIM3 directly and are counted in
+//    hardware. TIM3_IRQHandler is only called every 100 pulses, where it toggles the PA3
+//    LED, and on counter overflow to extend the count. Only works in Sleep mode. See
+//    pulse.h for details.
+//
+//  __CAPTURE_INPUT
+//    The frequency and duty cycle of a signal on PA6 (pin 12) are measured by TIM3 in PWM
+//    input mode, with DMA collecting 16 periods into a buffer. A batch is started by each
+//    TIM14 interrupt and DMA1_Channel4_5_IRQHandler is only called once the batch is
+//    complete. The PA3 LED is turned ON if the signal is above 1 kHz, otherwise OFF.
+//    Requires __TIMER_INTERRUPT. See capture.h for details.
+//
+//  __BUTTON_DEBOUNCER
+//    Alternative to __BUTTON_INTERRUPT for boards with more buttons. The buttons on PA0, PA1
+//    and PA2 wake the chip on either edge, after which all of GPIOA is sampled every 5 ms
+//    by a TIM17 software timer until every button is stable again. All buttons are
+//    debounced together, so no handler waits in a delay. Releasing a button does the same
+//    as with __BUTTON_INTERRUPT. In Stop mode, the chip only uses Sleep mode while the
+//    buttons are being sampled. See debounce.h and wheel.h for details.
+//
+//  __KEYPAD
+//    A 4x4 keypad matrix with rows on PA0, PA1, PA2, PB1 and columns on PA6, PA7, PA9,
+//    PA10, in place of the buttons. While no key is held, the rows are driven low and any
+//    key press wakes the chip through EXTI4_15_IRQHandler. The matrix is then scanned every
+//    10 ms until all keys are released. Each key press toggles the PA3 LED. See keypad.h
+//    for details.
+//
+//  __TOUCH_BUTTON
+//    A capacitive touch pad on PA10 (pin 18), with a 1M resistor from PA10 to VCC. Every
+//    50 ms, the charge time of the pad is measured with TIM1 input capture, which takes
+//    well under 100 us. The PA3 LED is ON while the pad is touched. Keeps a software timer
+//    running, so Stop mode falls back to Sleep mode. See touch.h for details.
+//
+//  __LOAD_SWITCH
+//    A sensor whose supply is switched by PB1 (pin 14), e.g. through a MOSFET. Each TIM14
+//    interrupt requests the sensor. It is powered, and 100 ms later, once it has warmed up,
+//    it is "read" by toggling the PA3 LED and released. It is then turned off once it has
+//    been on for 500 ms. The chip sleeps during the warm-up. Requires __TIMER_INTERRUPT.
+//    See load.h for details.
+//
+//  __ADC_SCAN
+//    Once a second, the internal temperature sensor and VREFINT are converted together in
+//    one ADC scan, with DMA filling a timestamped frame and a single interrupt at the end
+//    (DMA1_Channel1_IRQHandler). The main loop takes the frames from the queue, works out
+//    VDDA from VREFINT and turns ON the PA3 LED if VDDA is below 3.0 V. See scan.h and
+//    adc.h for details.
+//
+//  __TELEMETRY
+//    Each TIM14 interrupt adds a record with the wheel_now() time to a RAM buffer. The
+//    records are sent together as one frame on USART1 TX, PA9 (pin 17) at 115200 baud,
+//    once the buffer is 3/4 full or the oldest record is a minute old, and before entering
+//    Standby mode. USART1 is only powered while a frame is being sent. Requires
+//    __TIMER_INTERRUPT. See telem.h for details.
+//
+//  __CYCLIC_EXECUTIVE
+//    Two periodic tasks run from a schedule that is worked out by the compiler: every
+//    100 ms, the PA0 button is sampled, and every 10 s (offset by 500 ms) the PA3 LED is
+//    turned ON if the button was held during any of the samples since the last report,
+//    otherwise OFF. A single TIM17 software timer wakes the chip only for slots with work.
+//    See sched.h for details.
 //  ==========================================================================================
 
  #define __BUTTON_INTERRUPT
  #define __TIMER_INTERRUPT
  #define __SYSTICK_INTERRUPT
+// #define __BURST_OUTPUT
+// #define __ENCODER_INTERRUPT
+// #define __PULSE_COUNTER
+// #define __CAPTURE_INPUT
+// #define __BUTTON_DEBOUNCER
+// #define __KEYPAD
+// #define __TOUCH_BUTTON
+// #define __LOAD_SWITCH
+// #define __ADC_SCAN
+// #define __TELEMETRY
+// #define __CYCLIC_EXECUTIVE
+
+
+//  ==========================================================================================
+//  Clock Defines
+//
+//  __HSI_CALIBRATION
+//    Trim the internal 8 MHz HSI oscillator against a reference signal at startup so that
+//    the TIM14 and SysTick periods are closer to nominal. The reference is a 1 kHz square
+//    wave fed into PA7 (pin 13). While __TIMER_INTERRUPT is also defined, the TIM14 handler
+//    calibrates again whenever the reference is present, recording the trim at each new
+//    chip temperature. Without the reference, it re-reads the temperature and sets the trim
+//    predicted from the points recorded so far. See hsitrim.h for details.
+//
+//  __HSE_CLOCK
+//    For boards with an 8 MHz crystal on PF0 (pin 2) and PF1 (pin 3). Runs the chip at
+//    48 MHz from the PLL. The crystal is started in the background from the RCC interrupt,
+//    so main() does not wait for it. If the crystal fails, the clock security system falls
+//    back to the HSI through the NMI. Stop mode wakes up on the HSI, so the crystal is
+//    restarted in the background after each wake-up. TIM14 and SysTick are retimed
+//    whenever the clock changes. See clock.h for details.
+//  ==========================================================================================
+
+// #define __HSI_CALIBRATION
+// #define __HSE_CLOCK
+
+
+//  ==========================================================================================
+//  Debug Defines
+//
+//  __TRACE
+//    Records the GPIOA pins, the running handler and the power mode at the start and end
+//    of every handler and around every sleep, with microsecond time stamps. Once 64 events
+//    have been recorded, they are sent on USART1 TX, PA9 (pin 17) at 115200 baud as a VCD
+//    file, with an estimate of the supply current, and the next capture starts. Save the
+//    output to a file and open it in GTKWave to see how long each wake-up and handler
+//    takes. Cannot be used with __TELEMETRY, which also sends on USART1, or with
+//    __STOP_MODE, as the time stamps stop with the clocks in Stop mode. See trace.h for
+//    details.
+//
+//  __MARKERS
+//    Drives spare pins at the same points, for a logic analyzer. Each change is a single
+//    store to BSRR or BRR, and the markers compile to nothing when not defined:
+//      PA6  (pin 12)  MARK_HANDLER  High while a handler runs. A handler that interrupts
+//                                   another ends the pulse early.
+//      PA7  (pin 13)  MARK_SLEEP    High from just before WFI until the main loop resumes.
+//      PA9  (pin 17)  MARK_USER1    Free for temporary markers, e.g.
+//      PA10 (pin 18)  MARK_USER2      MARKER_HIGH( MARK_USER1 ); ... MARKER_LOW( MARK_USER1 );
+//      PB1  (pin 14)  MARK_USER3
+//    Comment out a marker below to leave its pin for another feature. See marker.h.
+//
+//  __LATENCY_BENCH
+//    Measures the interrupt latency and jitter at startup, before the demo runs, for each
+//    combination of 8 or 48 MHz, 0 or 1 flash wait states, prefetch off or on, and the
+//    vector table in flash or RAM. TIM3 toggles PA6 (pin 12), which must be wired to PA7
+//    (pin 13), and EXTI4_15_IRQHandler times each edge. It also times two EXTI lines that
+//    are pending at once, handled in one handler entry or in one entry per line. The
+//    results are sent on USART1 TX, PA9 (pin 17) at 115200 baud as tables in CPU cycles.
+//    See bench.h for details.
+//  ==========================================================================================
+
+// #define __TRACE
+// #define __MARKERS
+// #define __LATENCY_BENCH
+
+#ifdef __MARKERS
+#define MARK_HANDLER    GPIOA, GPIO_ODR_6
+#define MARK_SLEEP      GPIOA, GPIO_ODR_7
+#define MARK_USER1      GPIOA, GPIO_ODR_9
+#define MARK_USER2      GPIOA, GPIO_ODR_10
+#define MARK_USER3      GPIOB, GPIO_ODR_1
+#endif
+
+
+//  Some of the above share pins or timers and cannot be used together.
+#if defined( __HSI_CALIBRATION ) && defined( __ENCODER_INTERRUPT )
+#error "__HSI_CALIBRATION and __ENCODER_INTERRUPT both use PA7"
+#endif
+#if defined( __ENCODER_INTERRUPT ) && defined( __PULSE_COUNTER )
+#error "__ENCODER_INTERRUPT and __PULSE_COUNTER both use TIM3"
+#endif
+#if defined( __CAPTURE_INPUT ) && ( defined( __ENCODER_INTERRUPT ) || defined( __PULSE_COUNTER ) )
+#error "__CAPTURE_INPUT uses TIM3, as do __ENCODER_INTERRUPT and __PULSE_COUNTER"
+#endif
+#if defined( __BUTTON_DEBOUNCER ) && defined( __BUTTON_INTERRUPT )
+#error "__BUTTON_DEBOUNCER replaces __BUTTON_INTERRUPT, only define one of them"
+#endif
+
+#if defined( __KEYPAD ) && ( defined( __BUTTON_INTERRUPT ) || defined( __BUTTON_DEBOUNCER ) )
+#error "__KEYPAD uses the button pins PA0, PA1 and PA2 as rows"
+#endif
+#if defined( __KEYPAD ) && ( defined( __HSI_CALIBRATION ) || defined( __ENCODER_INTERRUPT ) || \
+                             defined( __PULSE_COUNTER ) || defined( __CAPTURE_INPUT ) ||      \
+                             defined( __BURST_OUTPUT ) )
+#error "__KEYPAD uses PA6, PA7 and PA9 as columns"
+#endif
+
+#if defined( __TOUCH_BUTTON ) && defined( __BURST_OUTPUT )
+#error "__TOUCH_BUTTON and __BURST_OUTPUT both use TIM1"
+#endif
+#if defined( __TOUCH_BUTTON ) && defined( __KEYPAD )
+#error "__TOUCH_BUTTON and __KEYPAD both use PA10"
+#endif
+#if defined( __LOAD_SWITCH ) && defined( __KEYPAD )
+#error "__LOAD_SWITCH and __KEYPAD both use PB1"
+#endif
+#if defined( __TELEMETRY ) && ( defined( __BURST_OUTPUT ) || defined( __KEYPAD ) )
+#error "__TELEMETRY uses PA9 for USART1 TX, as do __BURST_OUTPUT and __KEYPAD"
+#endif
+#if defined( __TRACE ) && ( defined( __BURST_OUTPUT ) || defined( __KEYPAD ) )
+#error "__TRACE uses PA9 for USART1 TX, as do __BURST_OUTPUT and __KEYPAD"
+#endif
+#if defined( __TRACE ) && defined( __TELEMETRY )
+#error "__TRACE and __TELEMETRY both use USART1, which telem.h may start using at any time"
+#endif
+#if defined( __TRACE ) && defined( __STOP_MODE )
+#error "__TRACE time stamps come from SysTick and TIM17, which both stop in Stop mode"
+#endif
+#if ( defined( MARK_HANDLER ) || defined( MARK_SLEEP ) ) &&                                 \
+    ( defined( __ENCODER_INTERRUPT ) || defined( __PULSE_COUNTER ) ||                        \
+      defined( __CAPTURE_INPUT ) || defined( __KEYPAD ) || defined( __HSI_CALIBRATION ) )
+#error "MARK_HANDLER and MARK_SLEEP use PA6 and PA7. Move them or comment them out."
+#endif
+#if defined( MARK_USER1 ) && ( defined( __BURST_OUTPUT ) || defined( __KEYPAD ) ||          \
+                               defined( __TELEMETRY ) || defined( __TRACE ) )
+#error "MARK_USER1 uses PA9. Move it or comment it out."
+#endif
+#if defined( MARK_USER2 ) && ( defined( __TOUCH_BUTTON ) || defined( __KEYPAD ) )
+#error "MARK_USER2 uses PA10. Move it or comment it out."
+#endif
+#if defined( MARK_USER3 ) && ( defined( __LOAD_SWITCH ) || defined( __KEYPAD ) )
+#error "MARK_USER3 uses PB1. Move it or comment it out."
+#endif
+#if defined( __LATENCY_BENCH ) && ( defined( __ENCODER_INTERRUPT ) ||                      \
+                                    defined( __PULSE_COUNTER ) || defined( __CAPTURE_INPUT ) )
+#error "__LATENCY_BENCH uses TIM3, as do __ENCODER_INTERRUPT, __PULSE_COUNTER and __CAPTURE_INPUT"
+#endif
+#if defined( __LATENCY_BENCH ) && ( defined( __HSI_CALIBRATION ) || defined( __KEYPAD ) ||  \
+                                    defined( __BURST_OUTPUT ) || defined( MARK_HANDLER ) || \
+                                    defined( MARK_SLEEP ) )
+#error "__LATENCY_BENCH uses PA6, PA7 and PA9. Remove the other features or markers on them."
+#endif
+#if defined( __CHECKPOINT ) && !defined( __STANDBY_MODE )
+#error "__CHECKPOINT is only needed with __STANDBY_MODE, the other modes keep the RAM"
+#endif
+#if defined( __ADC_SCAN ) && defined( __HSI_CALIBRATION )
+#error "__ADC_SCAN and __HSI_CALIBRATION (temperature readings) both use the ADC"
+#endif
+
+//  The following use the TIM17 software timers of wheel.h.
+#if defined( __BUTTON_DEBOUNCER ) || defined( __KEYPAD ) || defined( __TOUCH_BUTTON ) || \
+    defined( __LOAD_SWITCH ) || defined( __ADC_SCAN ) || defined( __TELEMETRY ) || \
+    defined( __CYCLIC_EXECUTIVE ) || defined( __TRACE )
+#define __WHEEL
+#endif
+
+//  Instrumentation points. Each handler calls HANDLER_ENTER() first and HANDLER_EXIT()
+//  last, and the main loop calls SLEEP_ENTER() and SLEEP_EXIT() around each sleep. These
+//  are recorded by __TRACE and shown on the __MARKERS pins.
+#ifdef __TRACE
+#define TRACE_HANDLER_ENTER()   trace_enter()
+#define TRACE_HANDLER_EXIT()    trace_exit()
+#define TRACE_SLEEP_ENTER()     trace_sleep( ( SCB->SCR & SCB_SCR_SLEEPDEEP_Msk ) ? \
+                                             TRACE_STOP : TRACE_SLEEP )
+#define TRACE_SLEEP_EXIT()      trace_wake()
+#else
+#define TRACE_HANDLER_ENTER()
+#define TRACE_HANDLER_EXIT()
+#define TRACE_SLEEP_ENTER()
+#define TRACE_SLEEP_EXIT()
+#endif
+
+#ifdef MARK_HANDLER
+#define MARK_HANDLER_ENTER()    MARKER_HIGH( MARK_HANDLER )
+#define MARK_HANDLER_EXIT()     MARKER_LOW( MARK_HANDLER )
+#else
+#define MARK_HANDLER_ENTER()
+#define MARK_HANDLER_EXIT()
+#endif
+
+#ifdef MARK_SLEEP
+#define MARK_SLEEP_ENTER()      MARKER_HIGH( MARK_SLEEP )
+#define MARK_SLEEP_EXIT()       MARKER_LOW( MARK_SLEEP )
+#else
+#define MARK_SLEEP_ENTER()
+#define MARK_SLEEP_EXIT()
+#endif
+
+// The markers change closest to the real start and end.
+#define HANDLER_ENTER()   do { MARK_HANDLER_ENTER(); TRACE_HANDLER_ENTER(); } while( 0 )
+#define HANDLER_EXIT()    do { TRACE_HANDLER_EXIT(); MARK_HANDLER_EXIT(); } while( 0 )
+#define SLEEP_ENTER()     do { TRACE_SLEEP_ENTER(); MARK_SLEEP_ENTER(); } while( 0 )
+#define SLEEP_EXIT()      do { MARK_SLEEP_EXIT(); TRACE_SLEEP_EXIT(); } while( 0 )
 
 
 #ifdef __BUTTON_INTERRUPT
@@ -171,39 +501,44 @@
 // Register to confirm which line generated the interrupt and act accordingly. Be sure to
 // clear the interrupt by setting the bit in the Pending Register to effectively clear it.
 //
-// Note that the handler pauses for appox. 3 seconds. During this time, other button presses
-// will not generate interrupts. This is to ilu
+// Both lines can be pending at the same time (e.g. both buttons pressed together). All
+// pending lines are handled in one pass, so that the second line does not cause a second
+// exception entry and a second debounce delay. The handled lines are then cleared with a
+// single write to the Pending Register. Note that "EXTI->PR |= x" must not be used to clear
+// a line: it reads back every pending bit and so would also clear lines not yet handled.
+// __LATENCY_BENCH measures the cycles saved by the single entry (see bench.h).
 void
 EXTI0_1_IRQHandler( void )
 {
-  for( uint32_t x=0; x<33000; x++ ) ;       // 50 ms debounce delay
-  if( EXTI->PR & EXTI_PR_PR0 )              // If detected rising edge on PA0:
+  HANDLER_ENTER();
+  delay_ms( 50 );                           // Debounce delay (once for all lines)
+
+  uint32_t pending = EXTI->PR & EXTI->IMR & // Lines that are both pending and enabled
+                     ( EXTI_PR_PR0 | EXTI_PR_PR1 );
+
+  if( pending & EXTI_PR_PR0 )               // If detected rising edge on PA0:
   {
     while( !(GPIOA->IDR & GPIO_IDR_0 )) ;   // Wait for debounce release
 
-    GPIOA->ODR |= GPIO_ODR_3 |              // Turn ON LEDs
-                  GPIO_ODR_4 |
-                  GPIO_ODR_5;
-
-//  Pause approx. 3 seconds
-//  for(uint32_t x=0; x<(uint32_t)2e6; x++) ;
+    gpio_set( GPIOA, GPIO_ODR_3 |           // Turn ON LEDs
+                     GPIO_ODR_4 |
+                     GPIO_ODR_5 );
+  }
 
-    EXTI->PR |= EXTI_PR_PR0;                // Clear the interrupt by *setting*
-  }                                         // the Pending Reg. bit
-  else
-    if( EXTI->PR & EXTI_PR_PR1 )    // If detected rising edge PA1:
-    {
-      while( !(GPIOA->IDR & GPIO_IDR_1) ) ; // Wait for debounce release
+  if( pending & EXTI_PR_PR1 )               // If detected rising edge PA1:
+  {
+    while( !(GPIOA->IDR & GPIO_IDR_1) ) ;   // Wait for debounce release
 
-      GPIOA->ODR &= ~(GPIO_ODR_3 |          // Turn OFF LEDs
-                      GPIO_ODR_4 |
-                      GPIO_ODR_5);
+    gpio_clear( GPIOA, GPIO_ODR_3 |         // Turn OFF LEDs
+                       GPIO_ODR_4 |
+                       GPIO_ODR_5 );
+  }
 
-//    Pause approx. 3 seconds
-//    for(uint32_t x=0; x<(uint32_t)2e6; x++) ;
-      
-      EXTI->PR |= EXTI_PR_PR1;              // Clear the interrupt by *setting*
-    }                                       // the Pending Reg. bit.
+  EXTI->PR = pending;                       // Clear the handled lines by *setting* their
+                                            // Pending Reg. bits, in one write.
+  if( pending )
+    WAKE_POST();                            // A button was handled (see wake.h)
+  HANDLER_EXIT();
 }
 
 
@@ -212,32 +547,63 @@ EXTI0_1_IRQHandler( void )
 //  ------------------------------------------------------------------------------------------
 // void EXTI2_3_IRQHandler( void )
 // This is the interrupt handler for external interrupt lines 2 (PA2) and 3 (PA3), so it is
-// called when the rising edge on PA2 generates an interrupt. External interrupt line 3 on
-// PA3 is not set up. Since only one of the two interrupt lines are used, it is not strictly
-// required to check betwen PA2 and PA3, however, PA2 must be cleared for the next event.
+// called when the rising edge on PA2 generates an interrupt. Line 3 is not used here, as
+// PA3 drives LED 1. If it is ever unmasked in EXTI->IMR, its pending bit is cleared along
+// with line 2 so that the interrupt does not repeat forever, but nothing else is done with
+// it; add an "if( pending & EXTI_PR_PR3 )" block next to the PA2 one to act on it.
 void
 EXTI2_3_IRQHandler( void )
 {
-//  if( EXTI->PR & EXTI_PR_PR2 )      // If detected rising edge on PA2: (Not needed since
-//  {                                 // line 3 / PA3 is not used here.)  
-    
-    for( uint32_t x = 0; x<33000; x++ ) ;   // 50 ms debounce delay
+  HANDLER_ENTER();
+  delay_ms( 50 );                           // Debounce delay
+
+  uint32_t pending = EXTI->PR & EXTI->IMR &
+                     ( EXTI_PR_PR2 | EXTI_PR_PR3 );
+
+  if( pending & EXTI_PR_PR2 )               // If detected rising edge on PA2:
+  {
     while( !(GPIOA->IDR & GPIO_IDR_2) ) ;   // Wait for debounce release
 
-    GPIOA->ODR ^= (GPIO_ODR_3 |             // Toggle LEDs
-                   GPIO_ODR_4 |
-                   GPIO_ODR_5);
+    gpio_toggle( GPIOA, GPIO_ODR_3 |        // Toggle LEDs
+                        GPIO_ODR_4 |
+                        GPIO_ODR_5 );
+  }
 
-    // Pause approx. 3 seconds
-    // for(uint32_t x=0; x<(uint32_t)2e6; x++) ;
-    
-    EXTI->PR |= EXTI_PR_PR2;          // Clear the interrupt by *setting*
-                                      // the Pending Reg. bit.
-//  }
+  EXTI->PR = pending;                       // Clear the handled lines
+  if( pending )
+    WAKE_POST();
+  HANDLER_EXIT();
 }
 #endif // __BUTTON_INTERRUPT
 
 
+#ifdef __LOAD_SWITCH
+//  ------------------------------------------------------------------------------------------
+//  Switched loads
+//  ------------------------------------------------------------------------------------------
+// Sensor supply on PB1, active high, 100 ms warm-up and at least 500 ms on.
+static const load_t loads[] =
+{
+  { GPIOB, GPIO_ODR_1, 0, 100, 500 },
+};
+#define LOAD_SENSOR ( 1 << 0 )
+
+
+//  ------------------------------------------------------------------------------------------
+//  sensorReady
+//  ------------------------------------------------------------------------------------------
+// void sensorReady( void )
+// Called from the TIM17 interrupt once the sensor has warmed up. This is where the sensor
+// would be read.
+static void
+sensorReady( void )
+{
+  gpio_toggle( GPIOA, GPIO_ODR_3 );         // Toggle LED 1 to show the reading
+  load_release( LOAD_SENSOR );
+}
+#endif // __LOAD_SWITCH
+
+
 #ifdef __TIMER_INTERRUPT
 //  ------------------------------------------------------------------------------------------
 //  TIM14_IRQHandler
@@ -252,21 +618,363 @@ EXTI2_3_IRQHandler( void )
 void
 TIM14_IRQHandler( void )
 {
-  GPIOA->ODR |= GPIO_ODR_4;                 // Flash LED 2
-  for(uint32_t x=0; x<15000; x++) ;
-  GPIOA->ODR &= ~GPIO_ODR_4;
+  HANDLER_ENTER();
+#ifdef __HSI_CALIBRATION
+  // hsitrim_compensate() needs points at two or more temperatures. While the reference
+  // is connected, record one at the present temperature, so that they build up as the chip
+  // warms up or cools down. Without the reference this gives up after 200 ms, and the trim
+  // is predicted from the points recorded so far instead. Calibrating needs the system
+  // clock on the HSI, so with __HSE_CLOCK only the prediction is used.
+#ifndef __HSE_CLOCK
+  if( hsitrim_calibrate( HSITRIM_REF_PA7, 1000, 100 ) == HSITRIM_FAILED )
+#endif
+    hsitrim_compensate();                   // Follow temperature drift of the HSI
+#endif
 
-  for(uint32_t x=0; x<(uint32_t)2e6; x++) ; // Pause approx 3 s
-  
-  GPIOA->ODR |= GPIO_ODR_4;                 // Flash LED 2
-  for(uint32_t x=0; x<15000; x++) ;
-  GPIOA->ODR &= ~GPIO_ODR_4;
+  gpio_set( GPIOA, GPIO_ODR_4 );            // Flash LED 2
+  delay_ms( 20 );
+  gpio_clear( GPIOA, GPIO_ODR_4 );
+
+  delay_ms( 3000 );                         // Pause 3 s (sleeping)
+
+  gpio_set( GPIOA, GPIO_ODR_4 );            // Flash LED 2
+  delay_ms( 20 );
+  gpio_clear( GPIOA, GPIO_ODR_4 );
+
+#ifdef __BURST_OUTPUT
+  burst_start( tconv_psc1kHz, 200, 50, 3, 0 );  // 3 x 50 ms flashes on PA9, 200 ms apart
+#endif
+
+#ifdef __CAPTURE_INPUT
+  capture_start();                          // Measure the next 16 periods on PA6
+#endif
+
+#ifdef __LOAD_SWITCH
+  load_request( LOAD_SENSOR, sensorReady ); // Power the sensor, read it once warmed up
+#endif
+
+#ifdef __TELEMETRY
+  uint32_t now = wheel_now();
+  telem_put( &now, sizeof( now ) );         // Only copied to RAM; sent later in a batch
+#endif
 
   TIM14->SR &= ~TIM_SR_UIF;                 // Clear timer interrupt flag
+  WAKE_POST();
+  HANDLER_EXIT();
 }
 #endif // __TIMER_INTERRUPT
 
 
+#ifdef __BURST_OUTPUT
+//  ------------------------------------------------------------------------------------------
+//  TIM1_BRK_UP_TRG_COM_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// void TIM1_BRK_UP_TRG_COM_IRQHandler( void )
+// Called once when a TIM1 pulse burst has finished.
+void
+TIM1_BRK_UP_TRG_COM_IRQHandler( void )
+{
+  HANDLER_ENTER();
+  burst_irq();
+  WAKE_POST();
+  HANDLER_EXIT();
+}
+#endif // __BURST_OUTPUT
+
+
+#ifdef __ENCODER_INTERRUPT
+//  ------------------------------------------------------------------------------------------
+//  TIM3_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// void TIM3_IRQHandler( void )
+// Called when the encoder position has moved by the threshold set in encoder_init().
+void
+TIM3_IRQHandler( void )
+{
+  HANDLER_ENTER();
+  encoder_irq();
+  WAKE_POST();
+  if( encoder_read() > 0 )
+    gpio_set( GPIOA, GPIO_ODR_3 );          // Clockwise: LED 1 ON
+  else
+    gpio_clear( GPIOA, GPIO_ODR_3 );        // Counterclockwise: LED 1 OFF
+  HANDLER_EXIT();
+}
+#endif // __ENCODER_INTERRUPT
+
+
+#ifdef __PULSE_COUNTER
+//  ------------------------------------------------------------------------------------------
+//  TIM3_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// void TIM3_IRQHandler( void )
+// Called every 100 pulses and every 65536 pulses (counter overflow). The total count is
+// available at any time from pulse_count().
+void
+TIM3_IRQHandler( void )
+{
+  HANDLER_ENTER();
+  pulse_irq();
+  if( pulse_thresholdHit )
+  {
+    pulse_thresholdHit = 0;
+    gpio_toggle( GPIOA, GPIO_ODR_3 );       // Toggle LED 1 every 100 pulses
+    WAKE_POST();                            // (An overflow alone is not counted as work)
+  }
+  HANDLER_EXIT();
+}
+#endif // __PULSE_COUNTER
+
+
+#ifdef __CAPTURE_INPUT
+//  ------------------------------------------------------------------------------------------
+//  DMA1_Channel4_5_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// void DMA1_Channel4_5_IRQHandler( void )
+// Called once a batch of periods has been captured by DMA. capture_result then holds the
+// average frequency and duty cycle of the batch.
+void
+DMA1_Channel4_5_IRQHandler( void )
+{
+  HANDLER_ENTER();
+  capture_irq();
+  if( capture_done )
+  {
+    if( capture_result.freqHz > 1000 )
+      gpio_set( GPIOA, GPIO_ODR_3 );        // Above 1 kHz: LED 1 ON
+    else
+      gpio_clear( GPIOA, GPIO_ODR_3 );
+    WAKE_POST();
+  }
+  HANDLER_EXIT();
+}
+#endif // __CAPTURE_INPUT
+
+
+#ifdef __WHEEL
+//  ------------------------------------------------------------------------------------------
+//  TIM17_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// void TIM17_IRQHandler( void )
+// Called when a software timer is due, and every 65.5 s to extend the millisecond count.
+// Only the first counts as work for wake.h.
+void
+TIM17_IRQHandler( void )
+{
+  HANDLER_ENTER();
+  if( wheel_irq() )
+    WAKE_POST();
+  HANDLER_EXIT();
+}
+#endif // __WHEEL
+
+
+#ifdef __BUTTON_DEBOUNCER
+//  ------------------------------------------------------------------------------------------
+//  buttonEdge
+//  ------------------------------------------------------------------------------------------
+// void buttonEdge( void )
+// The first edge on any button hands over to the debouncer, which masks the lines until
+// all buttons are stable again. EXTI0_1_IRQHandler and EXTI2_3_IRQHandler are generated
+// from the bindings below (see exti.h). This function is always_inline so that its body is
+// inlined into both even though main.c is built with -O0.
+static inline __attribute__(( always_inline )) void
+buttonEdge( void )
+{
+  HANDLER_ENTER();
+  debounce_exti();
+  WAKE_POST();
+  HANDLER_EXIT();
+}
+
+#define BUTTON_LINES_0_1( X, a )  X( a, EXTI_PR_PR0 | EXTI_PR_PR1, buttonEdge )
+#define BUTTON_LINES_2_3( X, a )  X( a, EXTI_PR_PR2, buttonEdge )
+EXTI_DEFINE_0_1( BUTTON_LINES_0_1 )
+EXTI_DEFINE_2_3( BUTTON_LINES_2_3 )
+
+
+//  ------------------------------------------------------------------------------------------
+//  buttonsChanged
+//  ------------------------------------------------------------------------------------------
+// void buttonsChanged( uint16_t changed, uint16_t state )
+// Called from the TIM17 interrupt when the debounced state of the buttons has changed. As
+// with __BUTTON_INTERRUPT, the action is taken when a button is released (goes high).
+static void
+buttonsChanged( uint16_t changed, uint16_t state )
+{
+  uint16_t released = changed & state;
+
+  if( released & GPIO_IDR_0 )
+    gpio_set( GPIOA, GPIO_ODR_3 | GPIO_ODR_4 | GPIO_ODR_5 );      // Turn ON LEDs
+  if( released & GPIO_IDR_1 )
+    gpio_clear( GPIOA, GPIO_ODR_3 | GPIO_ODR_4 | GPIO_ODR_5 );    // Turn OFF LEDs
+  if( released & GPIO_IDR_2 )
+    gpio_toggle( GPIOA, GPIO_ODR_3 | GPIO_ODR_4 | GPIO_ODR_5 );   // Toggle LEDs
+}
+#endif // __BUTTON_DEBOUNCER
+
+
+#ifdef __KEYPAD
+//  ------------------------------------------------------------------------------------------
+//  keyEdge
+//  ------------------------------------------------------------------------------------------
+// void keyEdge( void )
+// Called from the generated EXTI4_15_IRQHandler when a key is pressed while the keypad is
+// idle. Inlined into the handler (always_inline, as main.c is built with -O0).
+static inline __attribute__(( always_inline )) void
+keyEdge( void )
+{
+  HANDLER_ENTER();
+  keypad_exti();
+  WAKE_POST();
+  HANDLER_EXIT();
+}
+
+#define KEYPAD_LINES( X, a )  \
+  X( a, EXTI_PR_PR6 | EXTI_PR_PR7 | EXTI_PR_PR9 | EXTI_PR_PR10, keyEdge )
+EXTI_DEFINE_4_15( KEYPAD_LINES )
+
+
+//  ------------------------------------------------------------------------------------------
+//  keysChanged
+//  ------------------------------------------------------------------------------------------
+// void keysChanged( uint16_t pressed, uint16_t held )
+// Called from the TIM17 interrupt when keys have been pressed or released.
+static void
+keysChanged( uint16_t pressed, uint16_t held )
+{
+  if( pressed )
+    gpio_toggle( GPIOA, GPIO_ODR_3 );       // Toggle LED 1 on every key press
+}
+#endif // __KEYPAD
+
+
+#ifdef __LATENCY_BENCH
+//  ------------------------------------------------------------------------------------------
+//  EXTI4_15_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// Generated with bench_irq() bound directly to the loopback line, so that nothing runs
+// before it reads the timer. Not instrumented, as that would add to the latency measured.
+#define BENCH_BINDINGS( X, a )  X( a, BENCH_LINES, bench_irq )
+EXTI_DEFINE_4_15( BENCH_BINDINGS )
+#endif // __LATENCY_BENCH
+
+
+#ifdef __TOUCH_BUTTON
+//  ------------------------------------------------------------------------------------------
+//  touchChanged
+//  ------------------------------------------------------------------------------------------
+// void touchChanged( uint8_t touched )
+// Called from the TIM17 interrupt when the pad is touched or released.
+static void
+touchChanged( uint8_t touched )
+{
+  gpio_write( GPIOA, GPIO_ODR_3, touched ? GPIO_ODR_3 : 0 );   // LED 1 ON while touched
+}
+#endif // __TOUCH_BUTTON
+
+
+#ifdef __ADC_SCAN
+//  ------------------------------------------------------------------------------------------
+//  DMA1_Channel1_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// void DMA1_Channel1_IRQHandler( void )
+// Called once all channels of a scan have been converted. The frame is then in the queue
+// for the main loop.
+void
+DMA1_Channel1_IRQHandler( void )
+{
+  HANDLER_ENTER();
+  scan_irq();
+  WAKE_POST();
+  HANDLER_EXIT();
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  scanTick
+//  ------------------------------------------------------------------------------------------
+// void scanTick( void )
+// Called from the TIM17 interrupt once a second to start a scan.
+static void
+scanTick( void )
+{
+  scan_trigger();
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  scanConsume
+//  ------------------------------------------------------------------------------------------
+// void scanConsume( void )
+// Called from the main loop after every wake-up. VDDA = 3.3 V * VREFINT_CAL / VREFINT,
+// where VREFINT_CAL is the factory reading of VREFINT at VDDA = 3.3 V.
+#define VREFINT_CAL (*(const uint16_t *)0x1FFFF7BA)
+static void
+scanConsume( void )
+{
+  const scan_frame_t *frame;
+
+  while( (frame = scan_peek()) )
+  {
+    if( frame->value[1] )                   // value[0]: temperature
+    {
+      uint32_t vdda = 3300UL * VREFINT_CAL / frame->value[1];
+      gpio_write( GPIOA, GPIO_ODR_3, vdda < 3000 ? GPIO_ODR_3 : 0 );
+    }
+    scan_pop();
+  }
+}
+#endif // __ADC_SCAN
+
+
+#ifdef __TELEMETRY
+//  ------------------------------------------------------------------------------------------
+//  USART1_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// void USART1_IRQHandler( void )
+// Called once a telemetry frame has been sent completely.
+void
+USART1_IRQHandler( void )
+{
+  HANDLER_ENTER();
+  telem_irq();
+  WAKE_POST();
+  HANDLER_EXIT();
+}
+#endif // __TELEMETRY
+
+
+#ifdef __CYCLIC_EXECUTIVE
+//  ------------------------------------------------------------------------------------------
+//  Periodic tasks
+//  ------------------------------------------------------------------------------------------
+// Called from the TIM17 interrupt in the slots given by the schedule below.
+static uint16_t buttonHeld;                 // Samples with the PA0 button held
+
+static void
+taskSample( void )
+{
+  if( !(GPIOA->IDR & GPIO_IDR_0) )          // Button pulls PA0 low
+    buttonHeld++;
+}
+
+static void
+taskReport( void )
+{
+  gpio_write( GPIOA, GPIO_ODR_3, buttonHeld ? GPIO_ODR_3 : 0 );
+  buttonHeld = 0;
+}
+
+// function, period, offset, longest run time (all in ms)
+#define SCHED_SLOT_MS  100
+#define SCHED_TASKS( X, a )                 \
+  X( a, taskSample,   100,   0, 1 )         \
+  X( a, taskReport, 10000, 500, 1 )
+SCHED_DEFINE_TABLE( schedule )
+#endif // __CYCLIC_EXECUTIVE
+
+
 #ifdef __SYSTICK_INTERRUPT
 //  ------------------------------------------------------------------------------------------
 //  SysTick_Handler
@@ -276,15 +984,188 @@ TIM14_IRQHandler( void )
 // be initialized by calling the SysTick_Config( x ), where x is the number of clock ticks.
 // Note that x is a 24-bit number, meaning that with the 8 MHz internal clock, the longest
 // time that can be set is approx 16E6, or a time of 2 seconds.
+// The SysTick has priority 0 and so can interrupt the other handlers while they are driving
+// the LEDs. All LED changes therefore go through gpio.h, which uses single stores to the
+// BSRR/BRR registers instead of "GPIOA->ODR ^=", and toggles with interrupts disabled
+// between reading ODR and the store, so no LED change can be lost.
 
 void
 SysTick_Handler( void )
 {
-  GPIOA->ODR ^= GPIO_ODR_5;   // Toggle LED 3
+  HANDLER_ENTER();
+  gpio_toggle( GPIOA, GPIO_ODR_5 );   // Toggle LED 3
+  WAKE_POST();
+  HANDLER_EXIT();
 }
 #endif // __SYSTICK_INTERRUPT
 
 
+#ifdef __HSE_CLOCK
+//  ------------------------------------------------------------------------------------------
+//  clockChanged
+//  ------------------------------------------------------------------------------------------
+// void clockChanged( void )
+// Called whenever the system clock has switched between the HSI and the PLL. Reloads the
+// TIM14 prescaler so that it still ticks every 1 ms, and sets the SysTick to run from
+// HCLK/8 so that its 2 second period fits into 24 bits even at 48 MHz.
+static void
+clockChanged( void )
+{
+#ifdef __TIMER_INTERRUPT
+  TIM14->PSC = tconv_psc1kHz;               // Takes effect at the next update event
+#endif
+#ifdef __WHEEL
+  wheel_retime();
+#endif
+#ifdef __TOUCH_BUTTON
+  touch_calibrate();                        // Charge time in timer ticks has changed
+#endif
+#ifdef __SYSTICK_INTERRUPT
+  SysTick->CTRL &= ~SysTick_CTRL_CLKSOURCE_Msk;   // SysTick clock = HCLK/8
+  SysTick->LOAD  = (clock_hz >> 2) - 1;           // 2 s = HCLK*2/8 ticks
+  SysTick->VAL   = 0;
+#endif
+#ifdef __TRACE
+  trace_retime();                           // After the SysTick changes above
+#endif
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  RCC_IRQHandler
+//  ------------------------------------------------------------------------------------------
+// void RCC_IRQHandler( void )
+// Called when the HSE and then the PLL become ready. The switch to the PLL is done here
+// instead of polling the ready flags in main().
+void
+RCC_IRQHandler( void )
+{
+  HANDLER_ENTER();
+  if( clock_irq() )
+    clockChanged();
+  WAKE_POST();
+  HANDLER_EXIT();
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  NMI_Handler
+//  ------------------------------------------------------------------------------------------
+// void NMI_Handler( void )
+// The clock security system raises the NMI when the HSE fails. The hardware has already
+// switched back to the HSI by the time this runs.
+void
+NMI_Handler( void )
+{
+  HANDLER_ENTER();
+  if( clock_nmi() )
+    clockChanged();
+  HANDLER_EXIT();
+}
+#endif // __HSE_CLOCK
+
+
+
+//  ==========================================================================================
+//  Interrupt deadlines
+//  ------------------------------------------------------------------------------------------
+//  Each interrupt in use, with its deadline and longest handler run time in us, from which
+//  prio_assign() sets the priorities (see prio.h).
+//
+//  The run times are estimates for an 8 MHz clock, worked out from the code (the delays in
+//  a handler dominate where there are any), not measurements. To measure them, define
+//  __MARKERS and watch MARK_HANDLER on PA6 with a logic analyzer or scope: it is high for
+//  exactly the time each handler runs. Take the longest pulse seen for each interrupt over
+//  a representative run, round it up, and enter it here. Alternatively, __TRACE records the
+//  same start and end times with microsecond time stamps. Measure again after changing a
+//  handler or the clock; prio_missed then shows whether every deadline still holds.
+//
+//  Handlers that use delay.h (which is not reentrant) share RES_DELAY, and the handlers
+//  that debounce or scan inputs share RES_WHEEL with the TIM17 software timers that finish
+//  the job. Note that with __BUTTON_INTERRUPT and __TIMER_INTERRUPT together, the 3 s pause
+//  in TIM14_IRQHandler can hold off a button for far longer than its deadline, so those
+//  buttons are flagged in prio_missed.
+//  ==========================================================================================
+
+#define RES_DELAY   0x01
+#define RES_WHEEL   0x02
+
+#ifdef __ADC_SCAN
+#define WHEEL_SHARES ( RES_WHEEL | RES_DELAY )    // scan_trigger() uses the TIM16 stopwatch
+#else
+#define WHEEL_SHARES RES_WHEEL
+#endif
+
+static const prio_source_t irqSources[] =
+{
+//  irq                         deadline   run time   shares
+#ifdef __SYSTICK_INTERRUPT
+  { SysTick_IRQn,                   1000,        5,   0 },
+#endif
+#ifdef __BUTTON_INTERRUPT
+  { EXTI0_1_IRQn,                 100000,    60000,   RES_DELAY },
+  { EXTI2_3_IRQn,                 100000,    60000,   RES_DELAY },
+#endif
+#ifdef __TIMER_INTERRUPT
+#ifdef __HSI_CALIBRATION
+  { TIM14_IRQn,                 10000000,  3250000,   RES_DELAY },   // + 200 ms calibration
+#else
+  { TIM14_IRQn,                 10000000,  3050000,   RES_DELAY },
+#endif
+#endif
+#ifdef __BURST_OUTPUT
+  { TIM1_BRK_UP_TRG_COM_IRQn,       1000,        5,   0 },
+#endif
+#if defined( __ENCODER_INTERRUPT ) || defined( __PULSE_COUNTER )
+  { TIM3_IRQn,                     10000,       10,   0 },
+#endif
+#ifdef __CAPTURE_INPUT
+  { DMA1_Channel4_5_IRQn,          10000,       60,   0 },
+#endif
+#ifdef __WHEEL
+  { TIM17_IRQn,                     5000,      300,   WHEEL_SHARES },
+#endif
+#ifdef __BUTTON_DEBOUNCER
+  { EXTI0_1_IRQn,                   5000,       10,   RES_WHEEL },
+  { EXTI2_3_IRQn,                   5000,       10,   RES_WHEEL },
+#endif
+#ifdef __KEYPAD
+  { EXTI4_15_IRQn,                  5000,       10,   RES_WHEEL },
+#endif
+#ifdef __ADC_SCAN
+  { DMA1_Channel1_IRQn,            10000,       40,   0 },
+#endif
+#ifdef __TELEMETRY
+  { USART1_IRQn,                   10000,      300,   0 },
+#endif
+#ifdef __HSE_CLOCK
+  { RCC_IRQn,                      10000,       50,   0 },
+#endif
+};
+
+
+#ifdef __CHECKPOINT
+//  ==========================================================================================
+//  Checkpoint
+//  ------------------------------------------------------------------------------------------
+//  The variables kept across Standby (see ckpt.h). They are set just before going to sleep
+//  and used after ckpt_restore() has reloaded them on waking up.
+//  ==========================================================================================
+
+static uint16_t ledState;                   // PA3, PA4 and PA5 output levels
+#ifdef __HSI_CALIBRATION
+static uint32_t hsiTrim;                    // RCC_CR_HSITRIM bits
+#endif
+
+static const ckpt_var_t ckptVars[] =
+{
+  CKPT_VAR( ledState ),
+#ifdef __HSI_CALIBRATION
+  CKPT_VAR( hsiTrim ),
+#endif
+};
+#endif // __CHECKPOINT
+
 
 //  ==========================================================================================
 //  main
@@ -293,6 +1174,25 @@ SysTick_Handler( void )
 int
 main( void )
 {
+  clock_update();           // Record the current clock speed and precompute tick conversions
+
+#ifdef __LATENCY_BENCH
+  bench_run();              // Measure interrupt latency, then carry on with the demo
+#endif
+
+#ifdef __CHECKPOINT
+  ckpt_init( ckptVars, sizeof( ckptVars ) / sizeof( ckptVars[0] ) );
+  uint8_t resumed = ckpt_restore();   // Reload the variables if waking up from Standby
+#endif
+
+#ifdef __HSI_CALIBRATION
+#ifdef __CHECKPOINT
+  if( resumed )                       // Reuse the trim found before Standby
+    RCC->CR = ( RCC->CR & ~RCC_CR_HSITRIM ) | hsiTrim;
+  else
+#endif
+  hsitrim_calibrate( HSITRIM_REF_PA7, 1000, 100 );  // Trim HSI against 100 periods of 1 kHz
+#endif
 
 //  ------------------------------------------------------------------------------------------
 //  Set up GPIO pins as inputs and outputs as required
@@ -308,6 +1208,26 @@ main( void )
   GPIOA->MODER |= ( 0b01 << GPIO_MODER_MODER3_Pos |   // Set PA3, PA4, PA5 as outputs
                     0b01 << GPIO_MODER_MODER4_Pos |
                     0b01 << GPIO_MODER_MODER5_Pos );
+#ifdef __CHECKPOINT
+  GPIOA->BSRR = ledState;                             // LEDs as they were before Standby
+#endif
+
+  // Set up the marker pins that are in use as outputs
+#ifdef MARK_HANDLER
+  marker_init( MARK_HANDLER );
+#endif
+#ifdef MARK_SLEEP
+  marker_init( MARK_SLEEP );
+#endif
+#ifdef MARK_USER1
+  marker_init( MARK_USER1 );
+#endif
+#ifdef MARK_USER2
+  marker_init( MARK_USER2 );
+#endif
+#ifdef MARK_USER3
+  marker_init( MARK_USER3 );
+#endif
 
 
 #ifdef __BUTTON_INTERRUPT
@@ -323,10 +1243,8 @@ main( void )
 //  4. Configure the enable and mask bits that control the NVIC IRQ channel mapped to the
 //     EXTI so that an interrupt coming from one of the EXTI line can be correctly
 //     acknowledged.
-//  5. Set the priority of this interrupt. In this example, the interrupts generated on
-//     lines 0 and 1 will have a lower priority than the pin on line 2. Therefore, pressing
-//     button 3 will interrupt the delay caused by pressing buttons 1 or 2. However,
-//     pressing buttons 1 or 2 will not interrupt the delay caused by pressing button 3.
+//  5. Set the priority of this interrupt. Here all priorities are set together at the end
+//     of the setup by prio_assign(), from the deadlines in irqSources[].
 //
 //  Note that the EXTI_IMR_MRx lines default to pins on GPIOA. If pins on another GPIO port
 //  are desired, then the appropriate port must be set up in the SYSCFG_ESXTICRx register.
@@ -347,10 +1265,7 @@ main( void )
                 EXTI_RTSR_TR2;
 
   NVIC_EnableIRQ( EXTI0_1_IRQn );       // Enable this interrupt for lines 0 and 1
-  NVIC_SetPriority( EXTI0_1_IRQn, 1 );  // Set the priority to 1. (0 = highest)
-
   NVIC_EnableIRQ( EXTI2_3_IRQn );       // Enable this interrupt for lines 2 and 3
-  NVIC_SetPriority( EXTI2_3_IRQn, 1 );  // Set the desired priority (0 = highest)
 #endif // __BUTTON_INTERRUPT
 
 
@@ -364,23 +1279,86 @@ main( void )
 //  2. Enable the UIE bit in the DIER register of the timer to have an interrupt triggered
 //     when the timer overflows.
 //  3. Enable the NVIC TIMx_IRQn
-//  4. Set the NVIC TIMx_IRQn priority as needed
+//  4. Set the NVIC TIMx_IRQn priority as needed (done by prio_assign() below)
 
   // Set up the TIM14 prescaler for a 1 ms clock pulse, and have it turn over and toggle the
   // interrupt every 10 seconds.
   RCC->APB1ENR |= RCC_APB1ENR_TIM14EN;  // Enable TIM14
   RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN; // Turn on System Configuration Controller to allow
                                         // the GPIO pins to trigger interrupts.
-  TIM14->PSC    = 8000-1;               // Set prescaler to x8000 for 1 ms clock
+  TIM14->PSC    = tconv_psc1kHz;        // Set prescaler for 1 ms clock (8000-1 at 8 MHz)
   TIM14->ARR    = 10000-1;              // Set Auto Reload Register to 10,000 ms (10 s)
   TIM14->CR1   |= TIM_CR1_CEN;          // Start the timer
   TIM14->DIER  |= TIM_DIER_UIE;         // Have TIM14 generate interrupt when it overflows
 
   NVIC_EnableIRQ( TIM14_IRQn );         // Enable TIM14_IRQn
-  NVIC_SetPriority( TIM14_IRQn, 1);     // Set priority for TIM14_IRQn
 #endif // __TIMER_INTERRUPT
 
 
+#ifdef __BURST_OUTPUT
+  burst_init();                         // PA9 as TIM1_CH2 burst output
+#endif
+
+
+#ifdef __ENCODER_INTERRUPT
+  encoder_init( 4 );                    // Interrupt after every 4 counts (one detent)
+#endif
+
+
+#ifdef __PULSE_COUNTER
+  pulse_init( 100 );                    // Interrupt every 100 pulses
+#endif
+
+
+#ifdef __CAPTURE_INPUT
+  capture_init( 0 );                    // Timer clock resolution, 122 Hz minimum at 8 MHz
+#endif
+
+
+#ifdef __WHEEL
+  wheel_init();                         // TIM17 millisecond time base and software timers
+#endif
+
+
+#ifdef __BUTTON_DEBOUNCER
+  debounce_init( GPIO_IDR_0 | GPIO_IDR_1 | GPIO_IDR_2, buttonsChanged );
+  NVIC_EnableIRQ( EXTI0_1_IRQn );
+  NVIC_EnableIRQ( EXTI2_3_IRQn );
+#endif
+
+
+#ifdef __KEYPAD
+  keypad_init( keysChanged );
+  NVIC_EnableIRQ( EXTI4_15_IRQn );
+#endif
+
+
+#ifdef __TOUCH_BUTTON
+  touch_init( touchChanged );           // Pad must not be touched while starting up
+#endif
+
+
+#ifdef __LOAD_SWITCH
+  load_init( loads, sizeof( loads ) / sizeof( loads[0] ) );
+#endif
+
+
+#ifdef __TELEMETRY
+  telem_init();                         // USART1 TX on PA9, powered only while sending
+#endif
+
+
+#ifdef __CYCLIC_EXECUTIVE
+  sched_start( &schedule );             // Slot 0 starts now
+#endif
+
+
+#ifdef __ADC_SCAN
+  scan_init( ADC_CHSELR_CHSEL16 | ADC_CHSELR_CHSEL17, 7 );   // Temperature and VREFINT
+  wheel_start( WHEEL_ID_SCAN, 1000, 1000, scanTick );
+#endif
+
+
 #ifdef __SYSTICK_INTERRUPT
 //  ------------------------------------------------------------------------------------------
 //  Configure SysTick as interrupt trigger
@@ -392,11 +1370,20 @@ main( void )
 //    Note that a call to NVIC_EnableIRQ( SysTick_IRQn ) is not required.
   SysTick_Config( (uint32_t)16E6 );       // Configure the number of clock ticks between calls
                                           // to the SysTick interrupt handler.
-  NVIC_SetPriority( SysTick_IRQn, 0 );    // Set the desired priority of the SysTick interrupt
-                                          // though it defaults to 3, which is pretty high
 #endif // __SYSTICK_INTERRUPT
 
 
+#ifdef __TRACE
+  trace_init();                           // Uses SysTick for time stamps, so set up after it
+#endif
+
+
+//  ------------------------------------------------------------------------------------------
+//  Set all interrupt priorities from their deadlines
+//  ------------------------------------------------------------------------------------------
+  prio_assign( irqSources, sizeof( irqSources ) / sizeof( irqSources[0] ) );
+
+
 #ifdef __STANDBY_MODE
 //  Standby Mode -- Less than 10 uA while asleep
 //  Standby Mode halts all functionality and provides the lowest sleep power requirement.
@@ -435,12 +1422,61 @@ RCC->APB1ENR |= RCC_APB1ENR_PWREN;          // Enable PWR control clock
 #endif
 
 
+#ifdef __WAKE_ATTRIBUTION
+  wake_init( WAKE_MASKABLE );
+#endif
+
+
+#ifdef __HSE_CLOCK
+  clockChanged();             // Switch SysTick to HCLK/8 now, so the period is right at 8 MHz
+  clock_startHSE();           // Start the crystal. RCC_IRQHandler switches to it when ready.
+#endif
+
+
   // Main Cyclic Sleep Loop
   // This is where we go to sleep, and where well will reapper when woken up.
   while( 1 )
   {
+#if defined( __TELEMETRY ) && defined( __STANDBY_MODE )
+    telem_wait();             // Send what has been collected; RAM is lost in Standby
+#endif
+#ifdef __CHECKPOINT
+    ledState = GPIOA->ODR & ( GPIO_ODR_3 | GPIO_ODR_4 | GPIO_ODR_5 );
+#ifdef __HSI_CALIBRATION
+    hsiTrim  = RCC->CR & RCC_CR_HSITRIM;
+#endif
+    ckpt_save();              // Keep them in flash, as RAM is lost in Standby
+#endif
     PWR->CR |= PWR_CR_CWUF;   // Clear wake-up flag
+#if defined( __WHEEL ) && defined( __STOP_MODE )
+    if( wheel_pending() )     // TIM17 stops in Stop mode, so only use Sleep mode while a
+      SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;   // software timer is running.
+    else
+      SCB->SCR |=  SCB_SCR_SLEEPDEEP_Msk;
+#endif
+    SLEEP_ENTER();
+#ifdef __WAKE_ATTRIBUTION
+    wake_sleep();             // Go to sleep, then note what woke the chip
+#else
     __WFI();                  // Go to sleep
+#endif
+    SLEEP_EXIT();
+
+#if defined( __HSE_CLOCK ) && defined( __STOP_MODE )
+    if( clock_startHSE() )    // Stop mode woke up on the HSI. Restart the crystal.
+      clockChanged();
+#endif
+
+#ifdef __ADC_SCAN
+    scanConsume();            // Handle any ADC frames completed while asleep
+#endif
+
+#ifdef __TRACE
+    if( trace_full() )
+    {
+      trace_dump();           // Send the capture as a VCD file and start the next one
+    }
+#endif
   }
 
 } // End of main()
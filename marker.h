@@ -0,0 +1,59 @@
+//  ==========================================================================================
+//  marker.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Timing markers on spare pins, for a logic analyzer or scope.
+//
+//  Timing a handler with a timer changes the code being timed, and the result still has to
+//  be read out. Driving a spare pin high at the start and low at the end instead shows the
+//  timing of every run on the logic analyzer, next to the input that caused it, at the cost
+//  of a single store to the BSRR or BRR register (2 cycles).
+//
+//  A marker is given as "port, pins", e.g.
+//    #define MARK_SLEEP  GPIOA, GPIO_ODR_7
+//    ...
+//    marker_init( MARK_SLEEP );
+//    MARKER_HIGH( MARK_SLEEP );
+//    __WFI();
+//    MARKER_LOW( MARK_SLEEP );
+//  MARKER_HIGH and MARKER_LOW are macros rather than inline functions, so that they are a
+//  single store even in main.c, which is built without optimization. Markers that are not
+//  defined should be left out with #ifdef, so that they compile to nothing (see main.c).
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __MARKER_H
+#define __MARKER_H
+
+#include "stm32f030x6.h"
+
+#define MARKER_HIGH( marker )           MARKER_HIGH_( marker )
+#define MARKER_LOW( marker )            MARKER_LOW_( marker )
+#define MARKER_HIGH_( port, pins )      ( (port)->BSRR = (pins) )
+#define MARKER_LOW_( port, pins )       ( (port)->BRR  = (pins) )
+
+
+//  ------------------------------------------------------------------------------------------
+//  void marker_init( GPIO_TypeDef *port, uint32_t pins )
+//  Sets the pins up as push-pull outputs at high speed, driven low.
+//  ------------------------------------------------------------------------------------------
+static inline void
+marker_init( GPIO_TypeDef *port, uint32_t pins )
+{
+  RCC->AHBENR |= ( port == GPIOB ) ? RCC_AHBENR_GPIOBEN :
+                 ( port == GPIOF ) ? RCC_AHBENR_GPIOFEN : RCC_AHBENR_GPIOAEN;
+  port->BRR = pins;
+
+  for( uint8_t x=0; x<16; x++ )
+    if( pins & ( 1UL << x ) )
+    {
+      port->OTYPER  &= ~( 1UL << x );
+      port->OSPEEDR |=  ( 0b11UL << ( 2 * x ) );
+      port->MODER    = ( port->MODER & ~( 0b11UL << ( 2 * x ) ) ) | ( 0b01UL << ( 2 * x ) );
+    }
+}
+
+#endif // __MARKER_H
@@ -0,0 +1,93 @@
+//  ==========================================================================================
+//  prio.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See prio.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "prio.h"
+
+uint32_t prio_missed;
+uint8_t  prio_level[ PRIO_MAX ];
+
+
+//  ------------------------------------------------------------------------------------------
+//  prio_assign
+//  ------------------------------------------------------------------------------------------
+// Each source's rank is the number of different deadlines shorter than its own. Only runs
+// once at startup, so the simple O(n^2) loops are fine.
+uint8_t
+prio_assign( const prio_source_t *s, uint8_t count )
+{
+  uint8_t distinct = 0;
+  uint8_t rank[ PRIO_MAX ];
+
+  if( count > PRIO_MAX )
+    count = PRIO_MAX;
+
+  for( uint8_t i=0; i<count; i++ )
+  {
+    uint8_t first = 1;                      // First source with this deadline
+    rank[i] = 0;
+    for( uint8_t j=0; j<count; j++ )
+    {
+      if( s[j].deadlineUs >= s[i].deadlineUs )
+        continue;
+      uint8_t repeat = 0;                   // Count each shorter deadline once
+      for( uint8_t k=0; k<j; k++ )
+        if( s[k].deadlineUs == s[j].deadlineUs )
+          repeat = 1;
+      rank[i] += !repeat;
+    }
+    for( uint8_t j=0; j<i; j++ )
+      if( s[j].deadlineUs == s[i].deadlineUs )
+        first = 0;
+    distinct += first;
+  }
+
+  for( uint8_t i=0; i<count; i++ )
+    prio_level[i] = distinct <= PRIO_LEVELS ? rank[i] : rank[i] * PRIO_LEVELS / distinct;
+
+  // Sources sharing a resource move up to the highest level among them, until no more
+  // changes (a chain of shared resources can take a few passes).
+  uint8_t changed;
+  do
+  {
+    changed = 0;
+    for( uint8_t i=0; i<count; i++ )
+      for( uint8_t j=0; j<count; j++ )
+        if( ( s[i].shares & s[j].shares ) && prio_level[j] < prio_level[i] )
+        {
+          prio_level[i] = prio_level[j];
+          changed = 1;
+        }
+  } while( changed );
+
+  uint8_t misses = 0;
+  prio_missed = 0;
+  for( uint8_t i=0; i<count; i++ )
+  {
+    uint32_t blocking = 0, response = s[i].runUs;
+    for( uint8_t j=0; j<count; j++ )
+    {
+      if( j == i )
+        continue;
+      if( prio_level[j] < prio_level[i] )
+        response += s[j].runUs;
+      else if( prio_level[j] == prio_level[i] && s[j].runUs > blocking )
+        blocking = s[j].runUs;
+    }
+    if( response + blocking > s[i].deadlineUs )
+    {
+      prio_missed |= 1UL << i;
+      misses++;
+    }
+    NVIC_SetPriority( s[i].irq, prio_level[i] );
+  }
+
+  return misses;
+}
@@ -0,0 +1,58 @@
+//  ==========================================================================================
+//  prio.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Interrupt priorities derived from deadlines.
+//
+//  Setting each NVIC priority by hand gives no way to tell whether the most urgent
+//  interrupts can actually preempt the slow ones. Instead, each interrupt source is listed
+//  with the longest time it may wait before its handler has finished (its deadline) and the
+//  longest time its handler runs, as measured on the target (e.g. with a scope on a GPIO
+//  set at the start and cleared at the end of the handler). prio_assign() then:
+//    * Sorts the sources by deadline and gives the shortest deadlines the highest of the 4
+//      Cortex-M0 priority levels (deadline-monotonic order). With more than 4 different
+//      deadlines, neighbouring deadlines share a level.
+//    * Puts sources that share a resource on the same level, the highest of their levels,
+//      so that they can never preempt each other. An example is delay.h, which is not
+//      reentrant and so must not be used by two handlers that could preempt each other.
+//    * Checks every source against its deadline. The worst case response time is taken as
+//      the handler's own run time, plus the longest other handler on the same level (which
+//      cannot be preempted and may have just started), plus one run of every handler on a
+//      higher level. Sources that could miss their deadline are flagged in prio_missed.
+//
+//  Levels are 0 (highest) to 3. Critical sections with interrupts disabled are not
+//  included in the check and should be kept short.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __PRIO_H
+#define __PRIO_H
+
+#include "stm32f030x6.h"
+
+#define PRIO_LEVELS     ( 1 << __NVIC_PRIO_BITS )
+#define PRIO_MAX        32          // Most sources per table
+
+typedef struct
+{
+  IRQn_Type irq;                    // Interrupt, e.g. TIM14_IRQn or SysTick_IRQn
+  uint32_t  deadlineUs;             // Longest allowed time from request to handler done
+  uint32_t  runUs;                  // Longest measured handler run time
+  uint8_t   shares;                 // Resources used (bit mask), 0 if none
+} prio_source_t;
+
+extern uint32_t prio_missed;        // Bit n set if source n could miss its deadline
+extern uint8_t  prio_level[ PRIO_MAX ];     // Level given to each source
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t prio_assign( const prio_source_t *sources, uint8_t count )
+//  Sets the NVIC priority of each source as described above. Returns the number of sources
+//  that could miss their deadline.
+//  ------------------------------------------------------------------------------------------
+uint8_t prio_assign( const prio_source_t *sources, uint8_t count );
+
+#endif // __PRIO_H
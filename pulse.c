@@ -0,0 +1,101 @@
+//  ==========================================================================================
+//  pulse.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See pulse.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "pulse.h"
+
+volatile uint8_t  pulse_thresholdHit;
+static volatile uint32_t pulse_high;        // Number of 16-bit counter overflows
+static uint16_t   pulse_threshold;
+
+
+//  ------------------------------------------------------------------------------------------
+//  pulse_init
+//  ------------------------------------------------------------------------------------------
+void
+pulse_init( uint16_t threshold )
+{
+  RCC->AHBENR  |= RCC_AHBENR_GPIOAEN;
+  RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+
+  // PA6 as AF1 (TIM3_CH1) with pullup
+  GPIOA->MODER  = (GPIOA->MODER & ~GPIO_MODER_MODER6) | (0b10 << GPIO_MODER_MODER6_Pos);
+  GPIOA->PUPDR  = (GPIOA->PUPDR & ~GPIO_PUPDR_PUPDR6) | (0b01 << GPIO_PUPDR_PUPDR6_Pos);
+  GPIOA->AFR[0] = (GPIOA->AFR[0] & ~GPIO_AFRL_AFSEL6) | (1 << GPIO_AFRL_AFSEL6_Pos);
+
+  // TI1 filtered (8 samples), rising edge, as the trigger for external clock mode 1
+  TIM3->CR1   = 0;
+  TIM3->CCMR1 = TIM_CCMR1_CC1S_0 | (0b0011 << TIM_CCMR1_IC1F_Pos);
+  TIM3->CCMR2 = 0;
+  TIM3->CCER  = 0;
+  TIM3->SMCR  = (0b101 << TIM_SMCR_TS_Pos) | (0b111 << TIM_SMCR_SMS_Pos);
+  TIM3->PSC   = 0;
+  TIM3->ARR   = 0xFFFF;
+  TIM3->CNT   = 0;
+
+  pulse_high         = 0;
+  pulse_threshold    = threshold;
+  pulse_thresholdHit = 0;
+
+  TIM3->CCR3  = threshold;
+  TIM3->SR    = 0;
+  TIM3->DIER  = TIM_DIER_UIE | ( threshold ? TIM_DIER_CC3IE : 0 );
+  NVIC_EnableIRQ( TIM3_IRQn );
+
+  TIM3->CR1   = TIM_CR1_CEN;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  pulse_count
+//  ------------------------------------------------------------------------------------------
+// The overflow count and the counter cannot be read at the same instant. If an overflow is
+// pending but not yet handled (e.g. when called from a higher priority interrupt), a small
+// counter value means that it wrapped after pulse_high was last updated. The read is
+// repeated if the interrupt updated pulse_high in the meantime.
+uint64_t
+pulse_count( void )
+{
+  uint32_t high, count, overflow;
+
+  do
+  {
+    high     = pulse_high;
+    count    = TIM3->CNT;
+    overflow = TIM3->SR & TIM_SR_UIF;
+  } while( high != pulse_high );
+
+  if( overflow && count < 0x8000 )
+    high++;
+  return ((uint64_t)high << 16) | count;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  pulse_irq
+//  ------------------------------------------------------------------------------------------
+void
+pulse_irq( void )
+{
+  uint32_t sr = TIM3->SR;
+
+  if( sr & TIM_SR_UIF )
+  {
+    TIM3->SR = (uint32_t)~TIM_SR_UIF;
+    pulse_high++;
+  }
+
+  if( sr & TIM_SR_CC3IF )
+  {
+    TIM3->SR    = (uint32_t)~TIM_SR_CC3IF;
+    TIM3->CCR3  = (uint16_t)( TIM3->CCR3 + pulse_threshold );   // Wraps like the counter
+    pulse_thresholdHit = 1;
+  }
+}
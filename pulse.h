@@ -0,0 +1,57 @@
+//  ==========================================================================================
+//  pulse.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Hardware pulse counter using TIM3 in external clock mode.
+//
+//  Flow meters, tick sensors and the like produce a steady stream of pulses. Counting them
+//  with an EXTI interrupt per pulse keeps the chip awake most of the time. Instead, the
+//  pulses on PA6 (pin 12, TIM3_CH1) are used as the clock of TIM3 (external clock mode 1,
+//  trigger TI1FP1), so the counter counts them in hardware while the CPU sleeps.
+//
+//  The CPU is only woken:
+//    * When the count reaches the next multiple of the threshold (compare channel 3), if a
+//      threshold was given.
+//    * When the 16-bit counter overflows, every 65536 pulses, to extend the count in
+//      software to 48 bits (returned as a 64-bit value).
+//  The count can also be read at any time with pulse_count(), e.g. from a periodic timer.
+//
+//  The input has a pullup and a digital filter of 8 timer clock cycles and counts rising
+//  edges. Timers do not run in Stop mode, so pulses are only counted in Run or Sleep mode.
+//  TIM3_IRQHandler must call pulse_irq().
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __PULSE_H
+#define __PULSE_H
+
+#include "stm32f030x6.h"
+
+extern volatile uint8_t pulse_thresholdHit;   // Set by pulse_irq() at each threshold
+
+
+//  ------------------------------------------------------------------------------------------
+//  void pulse_init( uint16_t threshold )
+//  Sets up PA6 and TIM3 to count pulses, clears the count, and enables the TIM3 interrupt.
+//  If threshold is not 0, pulse_thresholdHit is set every `threshold` pulses.
+//  ------------------------------------------------------------------------------------------
+void pulse_init( uint16_t threshold );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint64_t pulse_count( void )
+//  Returns the number of pulses counted since pulse_init().
+//  ------------------------------------------------------------------------------------------
+uint64_t pulse_count( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void pulse_irq( void )
+//  Call from TIM3_IRQHandler. Extends the count on overflow and re-arms the threshold.
+//  ------------------------------------------------------------------------------------------
+void pulse_irq( void );
+
+#endif // __PULSE_H
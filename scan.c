@@ -0,0 +1,152 @@
+//  ==========================================================================================
+//  scan.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See scan.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "scan.h"
+#include "adc.h"
+#include "wheel.h"
+#include "delay.h"
+#include "tconv.h"
+
+uint16_t              scan_dropped;
+
+static scan_frame_t   scan_queue[ SCAN_FRAMES ];
+static uint8_t        scan_head;                // Frame being filled next
+static uint8_t        scan_tail;                // Oldest complete frame
+static volatile uint8_t scan_count;             // Complete frames in the queue
+static volatile uint8_t scan_busy;
+static uint32_t       scan_channels;
+static uint8_t        scan_length;
+static uint8_t        scan_smp;
+
+
+//  ------------------------------------------------------------------------------------------
+//  scan_init
+//  ------------------------------------------------------------------------------------------
+// Each channel takes one DMA transfer into frame->value[], so more than SCAN_CHANNELS
+// would overrun the frame.
+uint8_t
+scan_init( uint32_t channels, uint8_t smp )
+{
+  uint8_t length = 0;
+
+  for( uint32_t x=channels; x; x &= x - 1 )
+    length++;
+  scan_length = 0;                              // scan_trigger() refuses to run
+  if( length == 0 || length > SCAN_CHANNELS )
+    return 0;
+
+  RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+  scan_channels = channels;
+  scan_smp      = smp;
+  scan_length   = length;
+
+  DMA1_Channel1->CCR  = 0;
+  DMA1_Channel1->CPAR = (uint32_t)&ADC1->DR;
+  NVIC_EnableIRQ( DMA1_Channel1_IRQn );
+  return 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  scan_trigger
+//  ------------------------------------------------------------------------------------------
+// Called from thread or interrupt level, so the busy flag is claimed with interrupts off.
+uint8_t
+scan_trigger( void )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if( scan_busy || scan_count == SCAN_FRAMES || !scan_length )
+  {
+    if( !scan_busy && scan_length )
+      scan_dropped++;
+    __set_PRIMASK( primask );
+    return 0;
+  }
+  scan_busy = 1;
+  __set_PRIMASK( primask );
+
+  scan_frame_t *frame = &scan_queue[ scan_head ];
+  frame->timeMs = wheel_now();
+
+  // The sensors can only be switched on once the ADC is clocked, and must then settle
+  uint32_t sensors = ( scan_channels & ADC_CHSELR_CHSEL16 ? ADC_CCR_TSEN : 0 ) |
+                     ( scan_channels & ADC_CHSELR_CHSEL17 ? ADC_CCR_VREFEN : 0 );
+  adc_begin( scan_smp );
+  if( sensors )
+  {
+    ADC1_COMMON->CCR |= sensors;
+    delay_cycles( tconv_apply( SCAN_SENSOR_US, tconv_usToCycles ) );
+  }
+  ADC1->CHSELR = scan_channels;
+  ADC1->CFGR1 |= ADC_CFGR1_DMAEN;               // One-shot DMA, scan upwards
+
+  DMA1_Channel1->CCR   = 0;
+  DMA1->IFCR           = DMA_IFCR_CGIF1;
+  DMA1_Channel1->CMAR  = (uint32_t)frame->value;
+  DMA1_Channel1->CNDTR = scan_length;
+  DMA1_Channel1->CCR   = DMA_CCR_MINC | DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 |
+                         DMA_CCR_TCIE | DMA_CCR_EN;
+
+  ADC1->CR |= ADC_CR_ADSTART;
+  return 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  scan_irq
+//  ------------------------------------------------------------------------------------------
+void
+scan_irq( void )
+{
+  if( !(DMA1->ISR & DMA_ISR_TCIF1) )
+    return;
+
+  DMA1->IFCR         = DMA_IFCR_CGIF1;
+  DMA1_Channel1->CCR = 0;
+
+  ADC1_COMMON->CCR  &= ~( ADC_CCR_TSEN | ADC_CCR_VREFEN );
+  adc_end();
+
+  scan_head = ( scan_head + 1 ) % SCAN_FRAMES;
+  scan_count++;
+  scan_busy = 0;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  scan_peek
+//  ------------------------------------------------------------------------------------------
+const scan_frame_t *
+scan_peek( void )
+{
+  return scan_count ? &scan_queue[ scan_tail ] : 0;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  scan_pop
+//  ------------------------------------------------------------------------------------------
+// Only the consumer changes scan_tail, and scan_count is decremented with interrupts off
+// since scan_irq() increments it.
+void
+scan_pop( void )
+{
+  if( !scan_count )
+    return;
+
+  scan_tail = ( scan_tail + 1 ) % SCAN_FRAMES;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  scan_count--;
+  __set_PRIMASK( primask );
+}
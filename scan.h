@@ -0,0 +1,88 @@
+//  ==========================================================================================
+//  scan.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Multi-channel ADC acquisition into timestamped frames.
+//
+//  Reading several analog channels one at a time means powering the ADC and waking the CPU
+//  once per channel. Here a set of channels is converted as one group:
+//    * scan_trigger() powers the ADC (see adc.h) and starts a scan of all channels in the
+//      set, from the lowest channel number to the highest.
+//    * DMA1 channel 1 copies each result straight into the next free frame of a queue, and
+//      the CPU is only interrupted once, when the whole frame is done. The ADC is then
+//      powered down again.
+//    * Each frame holds the results and the wheel_now() time of the trigger.
+//    * The application takes complete frames from the queue in the order they were taken,
+//      with scan_peek() and scan_pop(), e.g. from the main loop. If the queue is full, the
+//      trigger is dropped and counted in scan_dropped, so no frame is ever overwritten.
+//
+//  The internal temperature sensor (channel 16) and VREFINT (channel 17) are switched on
+//  only during scans that include them, and scan_trigger() then spins for their start-up
+//  time of SCAN_SENSOR_US before starting. DMA1_Channel1_IRQHandler must call scan_irq().
+//  Uses wheel_now(), so wheel_init() must have been called.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __SCAN_H
+#define __SCAN_H
+
+#include "stm32f030x6.h"
+
+#ifndef SCAN_CHANNELS
+#define SCAN_CHANNELS   4           // Most channels per frame
+#endif
+#ifndef SCAN_FRAMES
+#define SCAN_FRAMES     4           // Frames in the queue
+#endif
+#define SCAN_SENSOR_US  10          // Start-up time of the temperature sensor and VREFINT
+
+typedef struct
+{
+  uint32_t timeMs;                  // wheel_now() when the scan was triggered
+  uint16_t value[ SCAN_CHANNELS ];  // Results, lowest channel number first
+} scan_frame_t;
+
+extern uint16_t scan_dropped;       // Triggers dropped because the queue was full
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t scan_init( uint32_t channels, uint8_t smp )
+//  Sets the channels to scan (bit n = channel n, at most SCAN_CHANNELS of them) and the
+//  sampling time setting (see adc_begin()). Sets up DMA1 channel 1 and its interrupt.
+//  Returns 0, and leaves scanning off, if no channels or too many are given.
+//  ------------------------------------------------------------------------------------------
+uint8_t scan_init( uint32_t channels, uint8_t smp );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t scan_trigger( void )
+//  Starts a scan and returns immediately. Returns 0 if a scan is already running, the
+//  queue is full, or scan_init() has not accepted a set of channels.
+//  ------------------------------------------------------------------------------------------
+uint8_t scan_trigger( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  const scan_frame_t *scan_peek( void )
+//  Returns the oldest complete frame, or 0 if there is none.
+//  ------------------------------------------------------------------------------------------
+const scan_frame_t *scan_peek( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void scan_pop( void )
+//  Frees the frame returned by scan_peek().
+//  ------------------------------------------------------------------------------------------
+void scan_pop( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void scan_irq( void )
+//  Call from DMA1_Channel1_IRQHandler. Completes the frame and powers down the ADC.
+//  ------------------------------------------------------------------------------------------
+void scan_irq( void );
+
+#endif // __SCAN_H
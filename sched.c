@@ -0,0 +1,104 @@
+//  ==========================================================================================
+//  sched.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See sched.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "sched.h"
+#include "wheel.h"
+
+uint16_t                    sched_overruns;
+
+static const sched_table_t *sched_table;
+static uint32_t             sched_base;     // wheel_now() at the start of this hyperperiod
+static uint16_t             sched_slot;     // Next slot to run
+
+static void sched_tick( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  sched_due
+//  ------------------------------------------------------------------------------------------
+static uint32_t
+sched_due( void )
+{
+  return sched_base + (uint32_t)sched_slot * sched_table->slotMs;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  sched_advance
+//  ------------------------------------------------------------------------------------------
+// Moves sched_slot on to the next slot (at or after `from`) that has tasks, continuing into
+// the next hyperperiod if needed, and sets the timer for its start. `from` is at most one
+// past the last slot, so wrapping is a compare and subtract rather than a "%", which would
+// call the __aeabi_uidiv division routine on every wake-up.
+static void
+sched_advance( uint16_t from )
+{
+  const sched_table_t *t = sched_table;
+
+  for( ;; from++ )
+  {
+    if( from >= t->slots )
+    {
+      sched_base += (uint32_t)t->slots * t->slotMs;
+      from       -= t->slots;
+    }
+    if( t->masks[ from ] )
+      break;
+  }
+  sched_slot = from;
+
+  int32_t wait = (int32_t)( sched_due() - wheel_now() );
+  wheel_start( WHEEL_ID_SCHED, wait > 0 ? wait : 0, 0, sched_tick );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  sched_tick
+//  ------------------------------------------------------------------------------------------
+// Runs the tasks of the current slot in table order.
+static void
+sched_tick( void )
+{
+  uint32_t start = sched_due();
+  uint8_t  mask  = sched_table->masks[ sched_slot ];
+
+  for( uint8_t x=0; mask; x++, mask >>= 1 )
+    if( mask & 1 )
+      sched_table->tasks[x]();
+
+  if( wheel_now() - start >= sched_table->slotMs )
+    sched_overruns++;
+
+  sched_advance( sched_slot + 1 );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  sched_start
+//  ------------------------------------------------------------------------------------------
+void
+sched_start( const sched_table_t *table )
+{
+  sched_table = table;
+  sched_base  = wheel_now();
+  sched_advance( 0 );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  sched_idleMs
+//  ------------------------------------------------------------------------------------------
+uint32_t
+sched_idleMs( void )
+{
+  int32_t wait = (int32_t)( sched_due() - wheel_now() );
+  return wait > 0 ? wait : 0;
+}
@@ -0,0 +1,127 @@
+//  ==========================================================================================
+//  sched.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Cyclic executive with a dispatch table built at compile time.
+//
+//  When all work is periodic (e.g. sample every 100 ms, report every 10 s), separate timers
+//  for each job wake the CPU at unrelated times and their timing drifts apart. Here all
+//  periodic tasks are listed in one table, and the compiler works out the complete
+//  schedule:
+//    * Time is divided into slots of SCHED_SLOT_MS. Every task period and offset must be a
+//      multiple of the slot length.
+//    * The hyperperiod (the least common multiple of the periods, after which the schedule
+//      repeats) is computed, and must be at most SCHED_MAX_SLOTS slots.
+//    * For every slot, a mask of the tasks that are due is stored in a constant table.
+//    * Each task also gives its longest run time, and it is checked that the tasks due in
+//      any one slot fit into the slot.
+//  Any mistake in the table is a compile error (_Static_assert), not a run-time surprise.
+//
+//  At run time, a single wheel.h timer is set to the start of the next slot that has any
+//  tasks, so the CPU sleeps through empty slots and sched_idleMs() gives the exact time
+//  until it is needed again. Slot times are computed from the start of the hyperperiod, so
+//  they do not drift. The tasks are called from the TIM17 interrupt.
+//
+//  Usage, in the file that defines the task functions (after them):
+//    #define SCHED_SLOT_MS  100
+//    #define SCHED_TASKS( X, a )  X( a, taskA, 100, 0, 2 ) X( a, taskB, 10000, 500, 5 )
+//    SCHED_DEFINE_TABLE( schedule )
+//    ...
+//    sched_start( &schedule );
+//  Each entry is X( a, function, period, offset, longest run time ), with times in ms, and
+//  is usually put on its own line (see main.c). The "a" argument is used internally and
+//  must be passed through to each X unchanged.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#include "stm32f030x6.h"
+
+#define SCHED_MAX_SLOTS 128         // Longest hyperperiod, in slots
+#define SCHED_MAX_TASKS 8           // Tasks per table (one bit each in the slot masks)
+
+typedef void (*sched_fn_t)( void );
+
+typedef struct
+{
+  uint16_t          slotMs;         // Slot length
+  uint16_t          slots;          // Hyperperiod in slots
+  const uint8_t    *masks;          // Tasks due in each slot (bit n = task n)
+  const sched_fn_t *tasks;          // Task functions in table order
+} sched_table_t;
+
+extern uint16_t sched_overruns;     // Slots whose tasks ran into the next slot
+
+
+//  ------------------------------------------------------------------------------------------
+//  Table generation
+//  ------------------------------------------------------------------------------------------
+// SCHED_R128( M, n ) expands to M(n) M(n+1) ... M(n+127).
+#define SCHED_R1( M, n )    M( n )
+#define SCHED_R2( M, n )    SCHED_R1( M, n )  SCHED_R1( M, (n)+1 )
+#define SCHED_R4( M, n )    SCHED_R2( M, n )  SCHED_R2( M, (n)+2 )
+#define SCHED_R8( M, n )    SCHED_R4( M, n )  SCHED_R4( M, (n)+4 )
+#define SCHED_R16( M, n )   SCHED_R8( M, n )  SCHED_R8( M, (n)+8 )
+#define SCHED_R32( M, n )   SCHED_R16( M, n ) SCHED_R16( M, (n)+16 )
+#define SCHED_R64( M, n )   SCHED_R32( M, n ) SCHED_R32( M, (n)+32 )
+#define SCHED_R128( M, n )  SCHED_R64( M, n ) SCHED_R64( M, (n)+64 )
+
+// Task is due in slot i
+#define SCHED_DUE( i, period, offset )  ( (i) * SCHED_SLOT_MS % (period) == (offset) )
+
+// Applied to each task of the table
+#define SCHED_X_BIT( a, fn, period, offset, run )    SCHED_BIT_##fn,
+#define SCHED_X_FN( a, fn, period, offset, run )     fn,
+#define SCHED_X_DIVIDES( h, fn, period, offset, run )  \
+  && ( (h) * SCHED_SLOT_MS % (period) == 0 )
+#define SCHED_X_MASK( i, fn, period, offset, run )   \
+  | ( SCHED_DUE( i, period, offset ) ? 1u << SCHED_BIT_##fn : 0 )
+#define SCHED_X_RUN( i, fn, period, offset, run )    \
+  + ( SCHED_DUE( i, period, offset ) ? (run) : 0 )
+#define SCHED_X_CHECK( a, fn, period, offset, run )  \
+  _Static_assert( (period) % SCHED_SLOT_MS == 0 && (offset) % SCHED_SLOT_MS == 0 &&   \
+                  (offset) < (period), #fn ": period and offset must be multiples of " \
+                  "SCHED_SLOT_MS, and the offset less than the period" );
+
+// Applied to each slot: the first h for which all periods divide h slots is the
+// hyperperiod; the mask of tasks due; and the run time of those tasks against the slot.
+#define SCHED_HYPER_TERM( h )  ( 1 SCHED_TASKS( SCHED_X_DIVIDES, (h)+1 ) ) ? (h)+1 :
+#define SCHED_MASK_TERM( i )   ( 0 SCHED_TASKS( SCHED_X_MASK, i ) ),
+#define SCHED_RUN_TERM( i )    \
+  ( (i) >= SCHED_HYPER_SLOTS || ( 0 SCHED_TASKS( SCHED_X_RUN, i ) ) <= SCHED_SLOT_MS ) &&
+
+// Defines the table `name` from SCHED_SLOT_MS and SCHED_TASKS. Only once per file.
+#define SCHED_DEFINE_TABLE( name )                                                        \
+  enum { SCHED_TASKS( SCHED_X_BIT, 0 ) SCHED_TASK_COUNT };                                \
+  enum { SCHED_HYPER_SLOTS = SCHED_R128( SCHED_HYPER_TERM, 0 ) 0 };                       \
+  _Static_assert( SCHED_TASK_COUNT <= SCHED_MAX_TASKS, "Too many tasks" );                \
+  _Static_assert( SCHED_HYPER_SLOTS != 0, "Hyperperiod longer than SCHED_MAX_SLOTS" );    \
+  SCHED_TASKS( SCHED_X_CHECK, 0 )                                                         \
+  _Static_assert( SCHED_R128( SCHED_RUN_TERM, 0 ) 1,                                      \
+                  "Tasks due in the same slot take longer than SCHED_SLOT_MS" );          \
+  static const uint8_t    name##_masks[ SCHED_MAX_SLOTS ] =                               \
+    { SCHED_R128( SCHED_MASK_TERM, 0 ) };                                                 \
+  static const sched_fn_t name##_tasks[] = { SCHED_TASKS( SCHED_X_FN, 0 ) };              \
+  static const sched_table_t name =                                                       \
+    { SCHED_SLOT_MS, SCHED_HYPER_SLOTS, name##_masks, name##_tasks };
+
+
+//  ------------------------------------------------------------------------------------------
+//  void sched_start( const sched_table_t *table )
+//  Starts running the schedule, with slot 0 starting now. The table must stay valid.
+//  ------------------------------------------------------------------------------------------
+void sched_start( const sched_table_t *table );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint32_t sched_idleMs( void )
+//  Returns the time in ms until the next slot with tasks.
+//  ------------------------------------------------------------------------------------------
+uint32_t sched_idleMs( void );
+
+#endif // __SCHED_H
@@ -0,0 +1,57 @@
+//  ==========================================================================================
+//  tconv.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See tconv.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "tconv.h"
+#include "clock.h"
+
+// Defaults match the 8 MHz HSI so conversions work before clock_update() is first called.
+tconv_ratio_t tconv_ticksToUs = TCONV_RATIO( 1000000, CLOCK_HSI_HZ, 34 );
+tconv_ratio_t tconv_usToTicks = TCONV_RATIO( CLOCK_HSI_HZ, 1000000, 28 );
+uint16_t      tconv_psc1MHz   = TCONV_PSC( CLOCK_HSI_HZ, 1000000 );
+uint16_t      tconv_psc1kHz   = TCONV_PSC( CLOCK_HSI_HZ, 1000 );
+tconv_ratio_t tconv_usToCycles = TCONV_RATIO( CLOCK_HSI_HZ, 1000000, 28 );
+
+
+//  ------------------------------------------------------------------------------------------
+//  tconv_makeRatio
+//  ------------------------------------------------------------------------------------------
+// Increase the shift one bit at a time for as long as the rounded-up multiplier stays below
+// 2^32 and num << shift does not overflow 64 bits.
+tconv_ratio_t
+tconv_makeRatio( uint32_t num, uint32_t den )
+{
+  tconv_ratio_t ratio;
+  uint8_t  shift = 0;
+  uint64_t limit = ((uint64_t)den << 32) - den;   // num << shift must stay at or below this
+
+  while( shift < 63 &&
+         ((uint64_t)num >> (63 - (shift + 1))) == 0 &&
+         ((uint64_t)num << (shift + 1)) <= limit )
+    shift++;
+
+  ratio.mult  = (uint32_t)( (((uint64_t)num << shift) + den - 1) / den );
+  ratio.shift = shift;
+  return ratio;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  tconv_update
+//  ------------------------------------------------------------------------------------------
+void
+tconv_update( uint32_t coreHz, uint32_t timerHz )
+{
+  tconv_ticksToUs = tconv_makeRatio( 1000000, timerHz );
+  tconv_usToTicks = tconv_makeRatio( timerHz, 1000000 );
+  tconv_psc1MHz   = TCONV_PSC( timerHz, 1000000 );
+  tconv_psc1kHz   = TCONV_PSC( timerHz, 1000 );
+  tconv_usToCycles = tconv_makeRatio( coreHz, 1000000 );
+}
@@ -0,0 +1,105 @@
+//  ==========================================================================================
+//  tconv.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Division-free conversion between timer ticks and time.
+//
+//  The Cortex-M0 has no divide instruction, so something like "ticks / 8" with a variable
+//  clock ends up calling the __aeabi_uidiv library routine, which takes well over 100 cycles.
+//  Instead, each conversion is stored as a fixed-point ratio (mult, shift) so that
+//
+//      result = ( value * mult ) >> shift
+//
+//  which is one 32x32 -> 64-bit multiply and a shift. mult is rounded up and always fits in
+//  32 bits, so for any 32-bit value the result is either exact or one count too high.
+//
+//  Runtime ratios for the current timer clock are recalculated by tconv_update(), which is
+//  called from clock_update() whenever the clock changes. The division needed to build a
+//  ratio is only done there, never on the conversion path.
+//
+//  For a clock that is fixed at build time, use TCONV_RATIO() and TCONV_PSC(), which are
+//  constant expressions and are folded by the compiler:
+//
+//    static const tconv_ratio_t ticksToUs8MHz = TCONV_RATIO( 1000000, 8000000, 34 );
+//    TIM14->PSC = TCONV_PSC( 8000000, 1000 );      // 1 kHz timer tick (7999)
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __TCONV_H
+#define __TCONV_H
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint32_t mult;                    // Multiplier, rounded up
+  uint8_t  shift;                   // Right shift applied to the 64-bit product
+} tconv_ratio_t;
+
+
+//  ------------------------------------------------------------------------------------------
+//  Compile-time helpers
+//  ------------------------------------------------------------------------------------------
+//  TCONV_RATIO( num, den, shift )
+//    Ratio num/den as a constant initializer. Pick the largest shift for which
+//    ceil( num * 2^shift / den ) still fits in 32 bits. For clock-to-us conversion from
+//    f MHz this is 31 + ceil( log2( f ) ), e.g. 34 for 8 MHz and 37 for 48 MHz.
+//  TCONV_PSC( clk_hz, tick_hz )
+//    Timer prescaler register value for the given tick rate.
+#define TCONV_RATIO( num, den, shift ) \
+  { (uint32_t)((((uint64_t)(num) << (shift)) + (den) - 1) / (den)), (shift) }
+
+#define TCONV_PSC( clk_hz, tick_hz )  ( (clk_hz) / (tick_hz) - 1 )
+
+
+//  ------------------------------------------------------------------------------------------
+//  Runtime ratios for the current timer clock (set by tconv_update)
+//  ------------------------------------------------------------------------------------------
+extern tconv_ratio_t tconv_ticksToUs;   // Timer clock ticks -> microseconds
+extern tconv_ratio_t tconv_usToTicks;   // Microseconds -> timer clock ticks
+extern uint16_t      tconv_psc1MHz;     // PSC value for a 1 us timer tick
+extern uint16_t      tconv_psc1kHz;     // PSC value for a 1 ms timer tick
+extern tconv_ratio_t tconv_usToCycles;  // Microseconds -> core clock cycles
+
+
+//  ------------------------------------------------------------------------------------------
+//  tconv_ratio_t tconv_makeRatio( uint32_t num, uint32_t den )
+//  Builds the most precise ratio for num/den whose multiplier fits in 32 bits. Uses a
+//  64-bit division, so keep it off the time-critical path.
+//  ------------------------------------------------------------------------------------------
+tconv_ratio_t tconv_makeRatio( uint32_t num, uint32_t den );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void tconv_update( uint32_t coreHz, uint32_t timerHz )
+//  Recalculates the runtime ratios and prescalers for new core and timer clock frequencies.
+//  ------------------------------------------------------------------------------------------
+void tconv_update( uint32_t coreHz, uint32_t timerHz );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint32_t tconv_apply( uint32_t value, tconv_ratio_t ratio )
+//  Returns value * ratio. A result that does not fit in 32 bits is truncated.
+//  ------------------------------------------------------------------------------------------
+static inline uint32_t
+tconv_apply( uint32_t value, tconv_ratio_t ratio )
+{
+  return (uint32_t)( ((uint64_t)value * ratio.mult) >> ratio.shift );
+}
+
+static inline uint32_t
+tconv_ticksToUsNow( uint32_t ticks )
+{
+  return tconv_apply( ticks, tconv_ticksToUs );
+}
+
+static inline uint32_t
+tconv_usToTicksNow( uint32_t us )
+{
+  return tconv_apply( us, tconv_usToTicks );
+}
+
+#endif // __TCONV_H
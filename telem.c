@@ -0,0 +1,213 @@
+//  ==========================================================================================
+//  telem.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See telem.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "telem.h"
+#include "clock.h"
+#include "wheel.h"
+
+uint16_t        telem_flushes;
+uint32_t        telem_bytesSent;
+uint16_t        telem_lastFlush;
+uint16_t        telem_dropped;
+
+// Two buffers, each with room for the checksum after TELEM_BUFFER bytes. The records start
+// after the 3 byte header.
+static uint8_t  telem_buffer[ 2 ][ TELEM_BUFFER + 1 ];
+static uint16_t telem_fill[ 2 ];
+static uint8_t  telem_current;              // Buffer being filled
+static volatile uint8_t telem_sending;      // 1 while the other buffer is being sent
+static uint8_t  telem_pending;              // Flush asked for while sending
+
+
+//  ------------------------------------------------------------------------------------------
+//  telem_init
+//  ------------------------------------------------------------------------------------------
+void
+telem_init( void )
+{
+  RCC->AHBENR |= RCC_AHBENR_GPIOAEN | RCC_AHBENR_DMA1EN;
+
+  // PA9 as AF1 (USART1_TX)
+  GPIOA->MODER  = (GPIOA->MODER & ~GPIO_MODER_MODER9) | (0b10 << GPIO_MODER_MODER9_Pos);
+  GPIOA->AFR[1] = (GPIOA->AFR[1] & ~GPIO_AFRH_AFSEL9) | (1 << GPIO_AFRH_AFSEL9_Pos);
+
+  DMA1_Channel2->CCR  = 0;
+  DMA1_Channel2->CPAR = (uint32_t)&USART1->TDR;
+
+  telem_fill[0] = telem_fill[1] = 3;
+  NVIC_EnableIRQ( USART1_IRQn );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  telem_age
+//  ------------------------------------------------------------------------------------------
+static void
+telem_age( void )
+{
+  telem_flush();
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  telem_flush
+//  ------------------------------------------------------------------------------------------
+// Adds the header and checksum to the current buffer, switches to the other buffer and
+// starts sending. If the other buffer is still being sent, the records stay where they are
+// and are sent by telem_irq() once it is done.
+void
+telem_flush( void )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint8_t  b    = telem_current;
+  uint16_t fill = telem_fill[b];
+  if( telem_sending || fill == 3 )
+  {
+    telem_pending = telem_sending && fill > 3;
+    __set_PRIMASK( primask );
+    return;
+  }
+
+  wheel_stop( WHEEL_ID_TELEM );
+  telem_pending = 0;
+  telem_current = b ^ 1;
+  telem_sending = 1;
+  __set_PRIMASK( primask );
+
+  uint8_t *frame = telem_buffer[b];
+  uint8_t  sum   = 0;
+  frame[0] = 0x7E;
+  frame[1] = ( fill - 3 ) & 0xFF;
+  frame[2] = ( fill - 3 ) >> 8;
+  for( uint16_t x=1; x<fill; x++ )
+    sum += frame[x];
+  frame[fill++] = -sum;
+
+  telem_lastFlush  = fill;
+  telem_bytesSent += fill;
+  telem_flushes++;
+
+  uint32_t pclk = ( RCC->CFGR & RCC_CFGR_PPRE_2 ) ? clock_timer_hz >> 1 : clock_timer_hz;
+  RCC->APB2ENR |= RCC_APB2ENR_USART1EN;
+  USART1->BRR   = ( pclk + TELEM_BAUD / 2 ) / TELEM_BAUD;
+  USART1->CR3   = USART_CR3_DMAT;
+  USART1->CR1   = USART_CR1_TE | USART_CR1_UE;
+  USART1->ICR   = USART_ICR_TCCF;
+
+  DMA1_Channel2->CCR   = 0;
+  DMA1->IFCR           = DMA_IFCR_CGIF2;
+  DMA1_Channel2->CMAR  = (uint32_t)frame;
+  DMA1_Channel2->CNDTR = fill;
+  DMA1_Channel2->CCR   = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_EN;
+
+  USART1->CR1  |= USART_CR1_TCIE;           // Interrupt after the last stop bit
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  telem_put
+//  ------------------------------------------------------------------------------------------
+uint8_t
+telem_put( const void *data, uint8_t length )
+{
+  uint8_t ok = 1;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint8_t b = telem_current;
+  if( telem_fill[b] + 1 + length > TELEM_BUFFER )
+  {
+    __set_PRIMASK( primask );
+    telem_flush();                          // Make room if the other buffer is free
+    __disable_irq();
+    b = telem_current;
+  }
+
+  if( telem_fill[b] + 1 + length > TELEM_BUFFER )
+  {
+    telem_dropped++;
+    ok = 0;
+  }
+  else
+  {
+    if( telem_fill[b] == 3 )                // First record: start the age limit
+      wheel_start( WHEEL_ID_TELEM, TELEM_MAX_AGE_MS, 0, telem_age );
+
+    uint8_t *p = &telem_buffer[b][ telem_fill[b] ];
+    *p++ = length;
+    for( uint8_t x=0; x<length; x++ )
+      *p++ = ((const uint8_t *)data)[x];
+    telem_fill[b] += 1 + length;
+  }
+
+  uint8_t full = telem_fill[b] >= TELEM_FLUSH_BYTES;
+  __set_PRIMASK( primask );
+
+  if( full )
+    telem_flush();
+  return ok;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  telem_irq
+//  ------------------------------------------------------------------------------------------
+// The frame has left the shift register. USART1 is switched off, and the other buffer is
+// sent straight away if it filled up or a flush was asked for in the meantime.
+void
+telem_irq( void )
+{
+  if( !(USART1->ISR & USART_ISR_TC) )
+    return;
+
+  USART1->ICR   = USART_ICR_TCCF;
+  USART1->CR1   = 0;
+  DMA1_Channel2->CCR = 0;
+  RCC->APB2ENR &= ~RCC_APB2ENR_USART1EN;
+
+  telem_fill[ telem_current ^ 1 ] = 3;
+  telem_sending = 0;
+
+  if( telem_pending || telem_fill[ telem_current ] >= TELEM_FLUSH_BYTES )
+    telem_flush();
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  telem_wait
+//  ------------------------------------------------------------------------------------------
+// Flushes until both buffers are empty, sleeping while each frame is sent. SLEEPDEEP is
+// cleared while waiting, as this is usually called with Stop or Standby mode already set up.
+// The test and the WFI are done with PRIMASK set, so that a TC interrupt in between cannot
+// leave the core asleep with nothing left to wake it. WFI still returns on the pending
+// interrupt, whose handler then runs once interrupts are enabled again.
+void
+telem_wait( void )
+{
+  uint32_t scr     = SCB->SCR;
+  uint32_t primask = __get_PRIMASK();
+  SCB->SCR = scr & ~SCB_SCR_SLEEPDEEP_Msk;
+
+  __disable_irq();
+  while( telem_sending || telem_fill[ telem_current ] > 3 )
+  {
+    telem_flush();
+    if( telem_sending )
+      __WFI();
+    __enable_irq();                         // Run the pending handler
+    __disable_irq();
+  }
+  __set_PRIMASK( primask );
+
+  SCB->SCR = scr;
+}
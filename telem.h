@@ -0,0 +1,85 @@
+//  ==========================================================================================
+//  telem.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Store-and-forward telemetry over USART1.
+//
+//  Sending every reading as soon as it is made keeps the UART, and any radio attached to it,
+//  powered most of the time. Here records are collected in RAM and sent together as one
+//  frame:
+//    * telem_put() only copies the record into the current buffer.
+//    * The buffer is sent when it holds TELEM_FLUSH_BYTES, when its oldest record is
+//      TELEM_MAX_AGE_MS old (timed by a wheel.h timer), or when telem_flush() is called,
+//      e.g. before entering Standby mode.
+//    * The frame is sent by DMA1 channel 2 while new records go into the other of two
+//      buffers. USART1 is clocked only while a frame is being sent, and is switched off
+//      from the transmission complete interrupt.
+//
+//  Frame format:
+//    0x7E, length (2 bytes, low byte first), records, checksum
+//  Each record is its length (1 byte) followed by its data. The checksum is chosen so that
+//  all bytes after the 0x7E add up to 0 (modulo 256).
+//
+//  TX is on PA9 (pin 17, USART1_TX, AF1) at TELEM_BAUD, 8N1. USART1_IRQHandler must call
+//  telem_irq(). Uses the WHEEL_ID_TELEM timer, so TIM17_IRQHandler must call wheel_irq().
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __TELEM_H
+#define __TELEM_H
+
+#include "stm32f030x6.h"
+
+#ifndef TELEM_BAUD
+#define TELEM_BAUD         115200
+#endif
+#define TELEM_BUFFER       128      // Bytes per buffer, including the frame header
+#define TELEM_FLUSH_BYTES  96       // Send once a buffer holds this many bytes
+#ifndef TELEM_MAX_AGE_MS
+#define TELEM_MAX_AGE_MS   60000    // Send once the oldest record is this old
+#endif
+
+extern uint16_t telem_flushes;      // Frames sent
+extern uint32_t telem_bytesSent;    // Bytes sent in all frames, including framing
+extern uint16_t telem_lastFlush;    // Bytes in the last frame
+extern uint16_t telem_dropped;      // Records dropped because both buffers were full
+
+
+//  ------------------------------------------------------------------------------------------
+//  void telem_init( void )
+//  Sets up PA9, DMA1 channel 2 and the USART1 interrupt. USART1 stays off until a flush.
+//  ------------------------------------------------------------------------------------------
+void telem_init( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t telem_put( const void *data, uint8_t length )
+//  Adds a record. Returns 0 if it was dropped because there was no room.
+//  ------------------------------------------------------------------------------------------
+uint8_t telem_put( const void *data, uint8_t length );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void telem_flush( void )
+//  Starts sending the records collected so far, if any, and returns immediately.
+//  ------------------------------------------------------------------------------------------
+void telem_flush( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void telem_wait( void )
+//  Sleeps until all frames have been sent, e.g. before entering Standby mode.
+//  ------------------------------------------------------------------------------------------
+void telem_wait( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void telem_irq( void )
+//  Call from USART1_IRQHandler.
+//  ------------------------------------------------------------------------------------------
+void telem_irq( void );
+
+#endif // __TELEM_H
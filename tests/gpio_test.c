@@ -0,0 +1,189 @@
+//  ==========================================================================================
+//  gpio_test.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Host test of gpio.h, run with "make test".
+//
+//  gpio.h is compiled against a mock port and a mock PRIMASK instead of the device header.
+//  Reading ODR returns the pin levels and then, if PRIMASK is clear, runs a pending
+//  "interrupt" before the value is used. This is exactly the moment at which a real
+//  interrupt would undo a read-modify-write. If PRIMASK is set, the interrupt stays pending
+//  until PRIMASK is cleared again, as on the chip. A store to BSRR or BRR is applied to the
+//  pin levels at the next access to the port.
+//
+//  The interrupt toggles a pin with gpio_toggle(), and each test checks that neither the
+//  main code's nor the interrupt's change is lost. As a check of the mock itself, the same
+//  toggle without disabling interrupts must lose the interrupt's toggle of the same pin.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define GPIO_ODR_3  0x0008
+#define GPIO_ODR_4  0x0010
+#define GPIO_ODR_5  0x0020
+
+
+//  ------------------------------------------------------------------------------------------
+//  Mock port and PRIMASK
+//  ------------------------------------------------------------------------------------------
+// Stores to BSRR and BRR are taken into store and applied by commit() at the next access.
+typedef struct
+{
+  uint32_t  reg;
+} mock_store_t;
+
+typedef struct
+{
+  uint32_t      (*odr)( void );
+  mock_store_t *(*bsrr)( void );
+  mock_store_t *(*brr)( void );
+} GPIO_TypeDef;
+
+#define ODR   odr()
+#define BSRR  bsrr()->reg
+#define BRR   brr()->reg
+
+static uint32_t     pins;               // Pin levels
+static mock_store_t bsrrStore, brrStore;
+static uint32_t     primask;
+static void       (*pending)( void );   // Interrupt waiting to run, or 0
+static unsigned     irqRuns;
+
+static void
+commit( void )
+{
+  pins |=  bsrrStore.reg & 0xFFFF;
+  pins &= ~( bsrrStore.reg >> 16 );
+  pins &= ~brrStore.reg;
+  bsrrStore.reg = 0;
+  brrStore.reg  = 0;
+}
+
+static void
+runPending( void )
+{
+  void (*handler)( void ) = pending;
+
+  if( handler && !primask )
+  {
+    pending = 0;
+    irqRuns++;
+    handler();
+  }
+}
+
+static uint32_t
+mockOdr( void )
+{
+  commit();
+  uint32_t value = pins;
+  runPending();                         // Preempted right after the load
+  return value;
+}
+
+static mock_store_t *mockBsrr( void ) { commit(); return &bsrrStore; }
+static mock_store_t *mockBrr( void )  { commit(); return &brrStore; }
+
+static GPIO_TypeDef port = { mockOdr, mockBsrr, mockBrr };
+#define GPIOA  ( &port )
+
+static uint32_t __get_PRIMASK( void )         { return primask; }
+static void     __disable_irq( void )         { primask = 1; }
+static void     __set_PRIMASK( uint32_t mask ) { primask = mask; runPending(); }
+
+#define __STM32F030x6_H                 // Keep the device header out
+#include "../gpio.h"
+
+
+//  ------------------------------------------------------------------------------------------
+//  Interrupts and the unprotected toggle
+//  ------------------------------------------------------------------------------------------
+static void irqToggle4( void ) { gpio_toggle( GPIOA, GPIO_ODR_4 ); }
+static void irqToggle3( void ) { gpio_toggle( GPIOA, GPIO_ODR_3 ); }
+
+static void
+unsafeToggle( GPIO_TypeDef *p, uint32_t mask )
+{
+  uint32_t high = p->ODR & mask;
+  p->BSRR = (high << 16) | (mask & ~high);
+}
+
+
+static unsigned long checked;
+static unsigned long failed;
+
+static void
+check( const char *name, uint32_t expected )
+{
+  commit();
+  checked++;
+  if( pins != expected || pending || irqRuns != 1 )
+  {
+    failed++;
+    printf( "FAIL %s: pins 0x%02lx, expected 0x%02lx, interrupt %s\n", name,
+            (unsigned long)pins, (unsigned long)expected,
+            pending ? "still pending" : irqRuns == 1 ? "ran once" : "ran more than once" );
+  }
+}
+
+static void
+start( uint32_t levels, void (*handler)( void ) )
+{
+  pins    = levels;
+  primask = 0;
+  pending = handler;
+  irqRuns = 0;
+}
+
+
+int
+main( void )
+{
+  // Another pin toggled by the interrupt in the middle of the toggle
+  start( GPIO_ODR_5, irqToggle4 );
+  gpio_toggle( GPIOA, GPIO_ODR_3 );
+  check( "other pin", GPIO_ODR_3 | GPIO_ODR_4 | GPIO_ODR_5 );
+
+  // The same pin toggled by both: two toggles leave it as it was
+  start( GPIO_ODR_3, irqToggle3 );
+  gpio_toggle( GPIOA, GPIO_ODR_3 );
+  check( "same pin", GPIO_ODR_3 );
+
+  // Called with interrupts already disabled: they must stay disabled afterwards
+  start( 0, irqToggle4 );
+  __disable_irq();
+  gpio_toggle( GPIOA, GPIO_ODR_3 );
+  checked++;
+  if( !primask )
+  {
+    failed++;
+    printf( "FAIL nested: PRIMASK was cleared\n" );
+  }
+  __set_PRIMASK( 0 );
+  check( "nested", GPIO_ODR_3 | GPIO_ODR_4 );
+
+  // A preempted toggle after gpio_write(), which changes only the given pins
+  start( GPIO_ODR_4, irqToggle3 );
+  gpio_write( GPIOA, GPIO_ODR_4 | GPIO_ODR_5, GPIO_ODR_5 );
+  gpio_toggle( GPIOA, GPIO_ODR_4 );
+  check( "write", GPIO_ODR_3 | GPIO_ODR_4 | GPIO_ODR_5 );
+
+  // The mock must catch the lost update of a toggle that leaves interrupts enabled
+  start( 0, irqToggle3 );
+  unsafeToggle( GPIOA, GPIO_ODR_3 );
+  commit();
+  checked++;
+  if( pins != GPIO_ODR_3 )
+  {
+    failed++;
+    printf( "FAIL mock: preemption of an unprotected toggle was not detected\n" );
+  }
+
+  printf( "gpio: %lu checks, %lu failed\n", checked, failed );
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+//  ==========================================================================================
+//  tconv_test.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Host test of tconv.h, run with "make test".
+//
+//  For each clock the chip can run at, the ratios built by tconv_makeRatio() are applied to
+//  inputs across the full 16-bit and 32-bit range and compared with exact integer division.
+//  As promised in tconv.h, each result must be exact or one count too high, for every input
+//  whose exact result fits in 32 bits. All 16-bit inputs are checked. Of the 32-bit range,
+//  every 4099th input is checked plus the last 65536 and those around each power of 2. Run
+//  "./tconv_test full" to check every 32-bit input (takes about an hour).
+//
+//  The TCONV_RATIO() defaults in tconv.c are also checked against tconv_makeRatio().
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include "../tconv.h"
+
+#define STRIDE      4099
+
+// HSI or HSE with the AHB prescaler, and the PLL from HSI / 2 or HSE / 1
+static const uint32_t clocks[] =
+{
+  1000000, 2000000, 4000000, 8000000, 12000000, 16000000, 20000000, 24000000,
+  28000000, 32000000, 36000000, 40000000, 44000000, 48000000
+};
+
+static unsigned long checked;
+static unsigned long failed;
+
+
+//  ------------------------------------------------------------------------------------------
+//  check
+//  ------------------------------------------------------------------------------------------
+static void
+check( const char *name, uint32_t num, uint32_t den, tconv_ratio_t r, uint32_t value )
+{
+  uint64_t exact = (uint64_t)value * num / den;
+  if( exact > 0xFFFFFFFF )
+    return;
+
+  uint32_t result = tconv_apply( value, r );
+  checked++;
+  if( result != exact && result != exact + 1 )
+  {
+    if( failed++ < 10 )
+      printf( "FAIL %s %lu/%lu: %lu -> %lu, expected %llu\n", name, (unsigned long)num,
+              (unsigned long)den, (unsigned long)value, (unsigned long)result,
+              (unsigned long long)exact );
+  }
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  checkRatio
+//  ------------------------------------------------------------------------------------------
+static void
+checkRatio( const char *name, uint32_t num, uint32_t den, int full )
+{
+  tconv_ratio_t r = tconv_makeRatio( num, den );
+
+  for( uint32_t v=0; v<=0xFFFF; v++ )
+    check( name, num, den, r, v );
+
+  if( full )
+  {
+    uint32_t v = 0x10000;
+    do
+      check( name, num, den, r, v );
+    while( v++ != 0xFFFFFFFF );
+    return;
+  }
+
+  for( uint64_t v=0x10000; v<=0xFFFFFFFF; v+=STRIDE )
+    check( name, num, den, r, (uint32_t)v );
+  for( uint32_t v=0xFFFF0000; v!=0; v++ )
+    check( name, num, den, r, v );
+  for( uint8_t bit=16; bit<32; bit++ )
+    for( int32_t d=-16; d<=16; d++ )
+      check( name, num, den, r, ( 1UL << bit ) + d );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  checkDefault
+//  ------------------------------------------------------------------------------------------
+static void
+checkDefault( const char *name, tconv_ratio_t r, uint32_t num, uint32_t den )
+{
+  tconv_ratio_t made = tconv_makeRatio( num, den );
+
+  checked++;
+  if( r.mult != made.mult || r.shift != made.shift )
+  {
+    failed++;
+    printf( "FAIL default %s: %lu >> %u, tconv_makeRatio() gives %lu >> %u\n", name,
+            (unsigned long)r.mult, r.shift, (unsigned long)made.mult, made.shift );
+  }
+}
+
+
+int
+main( int argc, char **argv )
+{
+  int full = argc > 1 && !strcmp( argv[1], "full" );
+
+  for( unsigned x=0; x<sizeof( clocks ) / sizeof( clocks[0] ); x++ )
+  {
+    uint32_t hz = clocks[x];
+
+    tconv_update( hz, hz );
+    checkRatio( "ticksToUs", 1000000, hz, full );
+    checkRatio( "usToTicks", hz, 1000000, full );
+    checkRatio( "ticksToMs", 1000, hz, full );
+    checkRatio( "msToTicks", hz, 1000, full );
+
+    if( tconv_psc1MHz != hz / 1000000 - 1 || tconv_psc1kHz != hz / 1000 - 1 )
+    {
+      failed++;
+      printf( "FAIL prescalers at %lu Hz\n", (unsigned long)hz );
+    }
+  }
+
+  // The defaults in tconv.c are built with TCONV_RATIO() and fixed shifts
+  tconv_ratio_t ticksToUs = TCONV_RATIO( 1000000, 8000000, 34 );
+  tconv_ratio_t usToTicks = TCONV_RATIO( 8000000, 1000000, 28 );
+  checkDefault( "ticksToUs", ticksToUs, 1000000, 8000000 );
+  checkDefault( "usToTicks", usToTicks, 8000000, 1000000 );
+
+  printf( "tconv: %lu checks, %lu failed\n", checked, failed );
+  return failed ? 1 : 0;
+}
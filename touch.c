@@ -0,0 +1,140 @@
+//  ==========================================================================================
+//  touch.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See touch.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "touch.h"
+#include "gpio.h"
+#include "delay.h"
+#include "wheel.h"
+#include "tconv.h"
+
+#define TOUCH_MODER_MASK   GPIO_MODER_MODER10
+#define TOUCH_MODER_OUT   ( 0b01 << GPIO_MODER_MODER10_Pos )
+#define TOUCH_MODER_AF    ( 0b10 << GPIO_MODER_MODER10_Pos )
+
+volatile uint8_t  touch_touched;
+static uint32_t   touch_base;               // Baseline, times 2^TOUCH_FILTER
+static volatile uint8_t touch_recalibrate;  // Take the next measurement as the baseline
+static touch_fn_t touch_changed;
+
+
+//  ------------------------------------------------------------------------------------------
+//  touch_measure
+//  ------------------------------------------------------------------------------------------
+// Interrupts are held off during each charge so that every sample is timed the same way.
+// The few cycles between releasing the pin and the timer seeing it are the same every time
+// and so end up in the baseline. The timer wraps after TOUCH_TIMEOUT_US, which bounds the
+// time with interrupts off. ARR is set from the current clock each time.
+uint32_t
+touch_measure( void )
+{
+  uint32_t sum     = 0;
+  uint32_t timeout = tconv_usToTicksNow( TOUCH_TIMEOUT_US );
+
+  if( timeout > 0x10000 )
+    timeout = 0x10000;
+
+  RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+  TIM1->ARR     = timeout - 1;
+  TIM1->CR1     = TIM_CR1_CEN;
+
+  for( uint8_t x=0; x<TOUCH_SAMPLES; x++ )
+  {
+    gpio_clear( GPIOA, GPIO_ODR_10 );                       // Discharge the electrode
+    GPIOA->MODER = ( GPIOA->MODER & ~TOUCH_MODER_MASK ) | TOUCH_MODER_OUT;
+    delay_us( 1 );
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TIM1->CNT    = 0;
+    TIM1->SR     = 0;
+    GPIOA->MODER = ( GPIOA->MODER & ~TOUCH_MODER_MASK ) | TOUCH_MODER_AF;
+    while( !( TIM1->SR & ( TIM_SR_CC3IF | TIM_SR_UIF ) ) ) ;
+    sum += ( TIM1->SR & TIM_SR_CC3IF ) ? TIM1->CCR3 : timeout;
+    __set_PRIMASK( primask );
+  }
+
+  GPIOA->MODER &= ~TOUCH_MODER_MASK;                        // Input, left charged to VCC
+  TIM1->CR1     = 0;
+  RCC->APB2ENR &= ~RCC_APB2ENR_TIM1EN;
+  return sum;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  touch_poll
+//  ------------------------------------------------------------------------------------------
+// The baseline only follows the measurement while not touched, otherwise a long touch
+// would slowly become the new baseline.
+static void
+touch_poll( void )
+{
+  uint32_t raw  = touch_measure();
+  uint8_t  was  = touch_touched;
+
+  if( touch_recalibrate )
+  {
+    touch_recalibrate = 0;
+    touch_base        = raw << TOUCH_FILTER;
+    touch_touched     = 0;
+  }
+  uint32_t base = touch_base >> TOUCH_FILTER;
+
+  if( !was && raw > base + ( base >> TOUCH_SHIFT ) )
+    touch_touched = 1;
+  else if( was && raw < base + ( base >> ( TOUCH_SHIFT + 1 ) ) )
+    touch_touched = 0;
+
+  if( !touch_touched )
+    touch_base += raw - base;
+
+  if( touch_touched != was && touch_changed )
+    touch_changed( touch_touched );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  touch_calibrate
+//  ------------------------------------------------------------------------------------------
+// Only sets a flag, so that the measurement is never started from an interrupt that could
+// preempt a measurement already in progress.
+void
+touch_calibrate( void )
+{
+  touch_recalibrate = 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  touch_init
+//  ------------------------------------------------------------------------------------------
+void
+touch_init( touch_fn_t changed )
+{
+  RCC->AHBENR  |= RCC_AHBENR_GPIOAEN;
+  RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+
+  // PA10 as TIM1_CH3 (AF2) when not an output, no pullup
+  GPIOA->PUPDR  &= ~GPIO_PUPDR_PUPDR10;
+  GPIOA->AFR[1]  = ( GPIOA->AFR[1] & ~GPIO_AFRH_AFSEL10 ) | ( 2 << GPIO_AFRH_AFSEL10_Pos );
+
+  // Channel 3 captures the rising edge of TI3, unfiltered so that the timing is exact
+  TIM1->CR1   = 0;
+  TIM1->PSC   = 0;
+  TIM1->CCMR2 = TIM_CCMR2_CC3S_0;
+  TIM1->CCER  = TIM_CCER_CC3E;
+  TIM1->DIER  = 0;
+  TIM1->EGR   = TIM_EGR_UG;
+
+  touch_changed = changed;
+  touch_touched = 0;
+  touch_base    = touch_measure() << TOUCH_FILTER;
+  wheel_start( WHEEL_ID_TOUCH, TOUCH_POLL_MS, TOUCH_POLL_MS, touch_poll );
+}
@@ -0,0 +1,84 @@
+//  ==========================================================================================
+//  touch.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Capacitive touch button, measured as the RC charge time of an electrode.
+//
+//  The STM32F030 has no touch sensing controller, but the time an electrode takes to
+//  charge through a high value resistor rises measurably when a finger adds capacitance:
+//
+//         VCC -- [1M] --+-- PA10 (pin 18)
+//                       |
+//                   Electrode (copper pad behind the enclosure wall)
+//
+//  To measure, PA10 is driven low to discharge the electrode, then released to TIM1_CH3
+//  input capture while TIM1 counts at the timer clock. The capture fires when the pin
+//  crosses the input high threshold. With about 10 pF on the electrode this takes around
+//  10 us, so a measurement of TOUCH_SAMPLES charges costs well under 100 us of CPU time.
+//  A charge that takes longer than TOUCH_TIMEOUT_US (e.g. with the resistor missing) is cut
+//  off by the timer update and counted as TOUCH_TIMEOUT_US, so interrupts are never held
+//  off for longer than that.
+//  Between measurements the pin is an input and TIM1's clock is off, so the electrode sits
+//  at VCC and no current flows.
+//
+//  The measurement runs every TOUCH_POLL_MS from a wheel.h timer. The charge time without a
+//  touch (the baseline) follows slow changes such as temperature and humidity through a
+//  filter. A touch is detected when the charge time is more than 1/2^TOUCH_SHIFT above the
+//  baseline, and released at half that, so the threshold does not depend on the clock or
+//  the electrode size. The application is only called when the touch state changes.
+//
+//  Uses TIM1, so cannot be used with burst.h. Uses the WHEEL_ID_TOUCH timer, so
+//  TIM17_IRQHandler must call wheel_irq(). Since the wheel timer is always running, the
+//  chip only uses Sleep mode (see wheel_pending()).
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __TOUCH_H
+#define __TOUCH_H
+
+#include "stm32f030x6.h"
+
+#ifndef TOUCH_POLL_MS
+#define TOUCH_POLL_MS   50          // Time between measurements
+#endif
+#define TOUCH_SAMPLES   4           // Charges summed per measurement
+#ifndef TOUCH_TIMEOUT_US
+#define TOUCH_TIMEOUT_US  50        // Longest charge, about 5 times the expected time
+#endif
+#define TOUCH_SHIFT     3           // Touch threshold: baseline + baseline/8
+#define TOUCH_FILTER    4           // Baseline follows 1/16 of each change
+
+// Called from the timer interrupt when the electrode is touched (1) or released (0).
+typedef void (*touch_fn_t)( uint8_t touched );
+
+extern volatile uint8_t touch_touched;      // 1 while touched
+
+
+//  ------------------------------------------------------------------------------------------
+//  void touch_init( touch_fn_t changed )
+//  Sets up PA10 and TIM1, measures the baseline and starts polling. The electrode must not
+//  be touched at this time.
+//  ------------------------------------------------------------------------------------------
+void touch_init( touch_fn_t changed );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void touch_calibrate( void )
+//  Takes the next measurement as the new baseline. Call after the timer clock has changed,
+//  as the charge time in timer ticks changes with it.
+//  ------------------------------------------------------------------------------------------
+void touch_calibrate( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint32_t touch_measure( void )
+//  Returns the sum of TOUCH_SAMPLES charge times in timer ticks. A charge that does not
+//  complete within TOUCH_TIMEOUT_US (e.g. a missing resistor) counts as TOUCH_TIMEOUT_US in
+//  ticks at the current clock, limited to 65536 ticks.
+//  ------------------------------------------------------------------------------------------
+uint32_t touch_measure( void );
+
+#endif // __TOUCH_H
@@ -0,0 +1,292 @@
+//  ==========================================================================================
+//  trace.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See trace.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "trace.h"
+#include "clock.h"
+#include "tconv.h"
+#include "wheel.h"
+#include "uart.h"
+
+#define TRACE_DEPTH     ( 1 + ( 1 << __NVIC_PRIO_BITS ) )  // Main loop + one handler per level
+
+typedef struct
+{
+  uint32_t timeUs;                          // Time since trace_init()
+  uint16_t pins;                            // GPIOA->IDR
+  uint8_t  exception;                       // IPSR
+  uint8_t  mode;                            // TRACE_RUN, TRACE_SLEEP or TRACE_STOP
+} trace_event_t;
+
+static trace_event_t trace_events[ TRACE_EVENTS ];
+static volatile uint8_t trace_count;
+
+static uint8_t       trace_exception;       // Exception running now
+static uint8_t       trace_stack[ TRACE_DEPTH ];    // Exceptions interrupted by it
+static uint8_t       trace_depth;
+
+static uint32_t      trace_time;            // Time of the last call, in us
+static uint32_t      trace_lastMs;          // wheel_now() at the last call
+static uint32_t      trace_lastTick;        // SysTick->VAL at the last call
+static uint32_t      trace_fineMs;          // Gaps shorter than this are timed by SysTick
+static tconv_ratio_t trace_ticksToUs;
+
+// Pins that exist on the 20-pin package
+static const uint8_t trace_pins[] = { 0, 1, 2, 3, 4, 5, 6, 7, 9, 10 };
+
+
+//  ------------------------------------------------------------------------------------------
+//  trace_retime
+//  ------------------------------------------------------------------------------------------
+// The time since the last call is carried over with 1 ms resolution, as the SysTick
+// counter may have been reloaded.
+void
+trace_retime( void )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint32_t hz  = ( SysTick->CTRL & SysTick_CTRL_CLKSOURCE_Msk ) ? clock_hz : clock_hz >> 3;
+  uint32_t now = wheel_now();
+
+  trace_ticksToUs = tconv_makeRatio( 1000000, hz );
+  trace_fineMs    = ( SysTick->LOAD + 1 ) / ( hz / 1000 ) / 2;
+  trace_time     += ( now - trace_lastMs ) * 1000;
+  trace_lastMs    = now;
+  trace_lastTick  = SysTick->VAL;
+
+  __set_PRIMASK( primask );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  trace_record
+//  ------------------------------------------------------------------------------------------
+// SysTick counts down from LOAD to 0. Within half a SysTick period the tick difference is
+// exact; beyond that the counter may have wrapped more than once, so wheel_now() is used.
+// Called with interrupts disabled.
+static void
+trace_record( uint8_t mode )
+{
+  uint32_t now  = wheel_now();
+  uint32_t tick = SysTick->VAL;
+
+  if( now - trace_lastMs < trace_fineMs )
+  {
+    int32_t ticks = (int32_t)( trace_lastTick - tick );
+    if( ticks < 0 )
+      ticks += SysTick->LOAD + 1;
+    trace_time += tconv_apply( ticks, trace_ticksToUs );
+  }
+  else
+    trace_time += ( now - trace_lastMs ) * 1000;
+  trace_lastMs   = now;
+  trace_lastTick = tick;
+
+  uint8_t n = trace_count;
+  if( n >= TRACE_EVENTS )
+    return;
+
+  uint16_t pins = GPIOA->IDR;
+  if( n && trace_events[n-1].pins == pins && trace_events[n-1].exception == trace_exception &&
+      trace_events[n-1].mode == mode )
+    return;
+
+  trace_events[n].timeUs    = trace_time;
+  trace_events[n].pins      = pins;
+  trace_events[n].exception = trace_exception;
+  trace_events[n].mode      = mode;
+  trace_count = n + 1;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  trace_init
+//  ------------------------------------------------------------------------------------------
+void
+trace_init( void )
+{
+  if( !( SysTick->CTRL & SysTick_CTRL_ENABLE_Msk ) )
+  {
+    SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;    // Free running, no interrupt
+    SysTick->VAL  = 0;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+  }
+
+  trace_lastMs = wheel_now();
+  trace_retime();
+
+  __disable_irq();
+  trace_record( TRACE_RUN );
+  __enable_irq();
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  trace_enter, trace_exit
+//  ------------------------------------------------------------------------------------------
+// A handler can only be interrupted by one of higher priority, so the exceptions form a
+// stack. Handlers run in Run mode, even if they woke the chip.
+void
+trace_enter( void )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  if( trace_depth < TRACE_DEPTH )
+    trace_stack[ trace_depth++ ] = trace_exception;
+  trace_exception = __get_IPSR();
+  trace_record( TRACE_RUN );
+
+  __set_PRIMASK( primask );
+}
+
+void
+trace_exit( void )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  trace_exception = trace_depth ? trace_stack[ --trace_depth ] : 0;
+  trace_record( TRACE_RUN );
+
+  __set_PRIMASK( primask );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  trace_sleep, trace_wake
+//  ------------------------------------------------------------------------------------------
+void
+trace_sleep( uint8_t mode )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  trace_record( mode );
+  __set_PRIMASK( primask );
+}
+
+void
+trace_wake( void )
+{
+  trace_sleep( TRACE_RUN );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  trace_full
+//  ------------------------------------------------------------------------------------------
+uint8_t
+trace_full( void )
+{
+  return trace_count >= TRACE_EVENTS;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  Output
+//  ------------------------------------------------------------------------------------------
+// Vector value, e.g. "b10011 ex"
+static void
+trace_putb( uint8_t value, const char *id )
+{
+  uint8_t bit = 0x80;
+
+  uart_putc( 'b' );
+  while( bit > 1 && !( value & bit ) )
+    bit >>= 1;
+  for( ; bit; bit >>= 1 )
+    uart_putc( ( value & bit ) ? '1' : '0' );
+  uart_putc( ' ' );
+  uart_puts( id );
+  uart_putc( '\n' );
+}
+
+static uint32_t
+trace_current( const trace_event_t *e )
+{
+  static const uint16_t modeUa[] = { TRACE_RUN_UA, TRACE_SLEEP_UA, TRACE_STOP_UA };
+  uint16_t leds = e->pins & TRACE_LEDS;
+  uint32_t ua   = modeUa[ e->mode ];
+
+  while( leds )
+  {
+    leds &= leds - 1;
+    ua += TRACE_LED_UA;
+  }
+  return ua;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  trace_dump
+//  ------------------------------------------------------------------------------------------
+// Only the values that differ from the previous event are written, as VCD requires. The
+// first event writes all values.
+void
+trace_dump( void )
+{
+  uint8_t count = trace_count;
+
+  uart_open( TRACE_BAUD );
+
+  uart_puts( "$timescale 1us $end\n$scope module stm32f030 $end\n" );
+  for( uint8_t x=0; x<sizeof( trace_pins ); x++ )
+  {
+    uart_puts( "$var wire 1 p" );
+    uart_putu( trace_pins[x] );
+    uart_puts( " PA" );
+    uart_putu( trace_pins[x] );
+    uart_puts( " $end\n" );
+  }
+  uart_puts( "$var wire 6 ex exception $end\n"
+             "$var wire 2 pm power_mode $end\n"
+             "$var real 64 ua supply_uA $end\n"
+             "$upscope $end\n$enddefinitions $end\n" );
+
+  for( uint8_t n=0; n<count; n++ )
+  {
+    const trace_event_t *e    = &trace_events[n];
+    const trace_event_t *prev = n ? &trace_events[n-1] : 0;
+
+    uart_putc( '#' );
+    uart_putu( e->timeUs );
+    uart_putc( '\n' );
+
+    for( uint8_t x=0; x<sizeof( trace_pins ); x++ )
+    {
+      uint16_t bit = 1 << trace_pins[x];
+      if( prev && !( ( e->pins ^ prev->pins ) & bit ) )
+        continue;
+      uart_putc( ( e->pins & bit ) ? '1' : '0' );
+      uart_putc( 'p' );
+      uart_putu( trace_pins[x] );
+      uart_putc( '\n' );
+    }
+    if( !prev || e->exception != prev->exception )
+      trace_putb( e->exception, "ex" );
+    if( !prev || e->mode != prev->mode )
+      trace_putb( e->mode, "pm" );
+    uint32_t ua = trace_current( e );
+    if( !prev || ua != trace_current( prev ) )
+    {
+      uart_putc( 'r' );
+      uart_putu( ua );
+      uart_puts( " ua\n" );
+    }
+  }
+
+  uart_close();
+
+  __disable_irq();                          // Start the next capture
+  trace_count = 0;
+  trace_record( TRACE_RUN );
+  __enable_irq();
+}
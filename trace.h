@@ -0,0 +1,113 @@
+//  ==========================================================================================
+//  trace.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  On-chip trace of pins, interrupts and power modes, sent as a VCD file for GTKWave.
+//
+//  Seeing how long the chip takes from waking up to acting, and how long it actually
+//  sleeps, normally needs a logic analyzer. Here the chip records this itself:
+//    * Each handler calls trace_enter() at its start and trace_exit() at its end, and the
+//      main loop calls trace_sleep() before and trace_wake() after each sleep.
+//    * Each call stores an event with a microsecond time stamp, the GPIOA input levels,
+//      the active exception (the IPSR register: 0 in the main loop, 15 for SysTick, 16 +
+//      IRQn for interrupts) and the power mode. Events that change nothing are skipped.
+//    * Once TRACE_EVENTS events have been stored, recording stops and trace_full() returns
+//      1. trace_dump() then sends the events on USART1 TX as a Value Change Dump (VCD)
+//      file, and starts the next capture.
+//    * The supply current is not measured, but estimated for each event from the power mode
+//      and the LEDs that are on, using the TRACE_xxx_UA values below. It shows up in the VCD
+//      file as an analog trace.
+//
+//  The time stamps come from the SysTick counter, which is started without its interrupt
+//  if it is not already running. It wraps every 2 s or less, so for longer gaps the time is
+//  taken from wheel_now() with 1 ms resolution. SysTick and TIM17 (wheel_now()) both stop
+//  in Stop mode, which would make every stop look about 0 us long, so main.c does not allow
+//  __TRACE together with __STOP_MODE.
+//  Each call takes a few microseconds, which shows up in the trace itself.
+//
+//  The dump is sent with uart.h on PA9 (pin 17, USART1_TX) at TRACE_BAUD, 8N1, and takes
+//  about 3 ms per event at 115200 baud. Capture the output to a .vcd file with any serial
+//  terminal.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include "stm32f030x6.h"
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS    64          // Events per capture, 8 bytes each
+#endif
+#ifndef TRACE_BAUD
+#define TRACE_BAUD      115200
+#endif
+
+// Power modes
+#define TRACE_RUN       0
+#define TRACE_SLEEP     1
+#define TRACE_STOP      2
+
+// Supply current estimates at 3.3 V and 8 MHz (see "Summary of Sleep Modes" in main.c)
+#ifndef TRACE_RUN_UA
+#define TRACE_RUN_UA    1800
+#define TRACE_SLEEP_UA  1100
+#define TRACE_STOP_UA   230
+#define TRACE_LED_UA    1300        // Per LED: (3.3 V - 2.0 V) / 1K
+#define TRACE_LEDS      ( GPIO_ODR_3 | GPIO_ODR_4 | GPIO_ODR_5 )
+#endif
+
+
+//  ------------------------------------------------------------------------------------------
+//  void trace_init( void )
+//  Sets up the SysTick counter and starts the first capture. Call after wheel_init() and
+//  after SysTick_Config(), if used.
+//  ------------------------------------------------------------------------------------------
+void trace_init( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void trace_retime( void )
+//  Call after the system clock has changed.
+//  ------------------------------------------------------------------------------------------
+void trace_retime( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void trace_enter( void )
+//  void trace_exit( void )
+//  Call at the start and end of a handler.
+//  ------------------------------------------------------------------------------------------
+void trace_enter( void );
+void trace_exit( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void trace_sleep( uint8_t mode )
+//  void trace_wake( void )
+//  Call just before going to sleep in the given mode (TRACE_SLEEP or TRACE_STOP), and just
+//  after waking up.
+//  ------------------------------------------------------------------------------------------
+void trace_sleep( uint8_t mode );
+void trace_wake( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t trace_full( void )
+//  Returns 1 once the capture is complete and should be sent with trace_dump().
+//  ------------------------------------------------------------------------------------------
+uint8_t trace_full( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void trace_dump( void )
+//  Sends the events recorded so far as a VCD file and starts the next capture. Takes USART1
+//  for about 200 ms, so must not be used together with telem.h, which may start a DMA frame
+//  from an interrupt at any time.
+//  ------------------------------------------------------------------------------------------
+void trace_dump( void );
+
+#endif // __TRACE_H
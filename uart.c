@@ -0,0 +1,78 @@
+//  ==========================================================================================
+//  uart.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See uart.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "uart.h"
+#include "clock.h"
+
+
+//  ------------------------------------------------------------------------------------------
+//  uart_open
+//  ------------------------------------------------------------------------------------------
+void
+uart_open( uint32_t baud )
+{
+  uint32_t pclk = ( RCC->CFGR & RCC_CFGR_PPRE_2 ) ? clock_timer_hz >> 1 : clock_timer_hz;
+
+  RCC->AHBENR  |= RCC_AHBENR_GPIOAEN;
+  GPIOA->MODER  = (GPIOA->MODER & ~GPIO_MODER_MODER9) | (0b10 << GPIO_MODER_MODER9_Pos);
+  GPIOA->AFR[1] = (GPIOA->AFR[1] & ~GPIO_AFRH_AFSEL9) | (1 << GPIO_AFRH_AFSEL9_Pos);
+
+  RCC->APB2ENR |= RCC_APB2ENR_USART1EN;
+  USART1->CR1   = 0;
+  USART1->CR3   = 0;
+  USART1->BRR   = ( pclk + baud / 2 ) / baud;
+  USART1->CR1   = USART_CR1_TE | USART_CR1_UE;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  uart_putc, uart_puts, uart_putu
+//  ------------------------------------------------------------------------------------------
+void
+uart_putc( char c )
+{
+  while( !( USART1->ISR & USART_ISR_TXE ) ) ;
+  USART1->TDR = c;
+}
+
+void
+uart_puts( const char *s )
+{
+  while( *s )
+    uart_putc( *s++ );
+}
+
+void
+uart_putu( uint32_t value )
+{
+  char    digits[10];
+  uint8_t n = 0;
+
+  do
+  {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while( value );
+  while( n )
+    uart_putc( digits[--n] );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  uart_close
+//  ------------------------------------------------------------------------------------------
+void
+uart_close( void )
+{
+  while( !( USART1->ISR & USART_ISR_TC ) ) ;
+  USART1->CR1   = 0;
+  RCC->APB2ENR &= ~RCC_APB2ENR_USART1EN;
+}
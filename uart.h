@@ -0,0 +1,52 @@
+//  ==========================================================================================
+//  uart.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Polled text output on USART1 TX, for reports and debug dumps.
+//
+//  telem.h sends binary frames by DMA in the background. Reports that are only sent now and
+//  then, such as the trace.h dump or the bench.h results, are simpler to write out one
+//  character at a time: uart_open() powers USART1, the uart_putx() functions wait for room
+//  in the transmit register, and uart_close() waits for the last stop bit and switches
+//  USART1 off again. Interrupts stay enabled while sending.
+//
+//  TX is on PA9 (pin 17, USART1_TX, AF1), 8N1. The baud rate is set from the current clock,
+//  so do not change the clock between uart_open() and uart_close(). Must not be used while
+//  telem.h is sending.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __UART_H
+#define __UART_H
+
+#include "stm32f030x6.h"
+
+
+//  ------------------------------------------------------------------------------------------
+//  void uart_open( uint32_t baud )
+//  Sets up PA9 as USART1 TX and switches USART1 on at the given baud rate.
+//  ------------------------------------------------------------------------------------------
+void uart_open( uint32_t baud );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void uart_putc( char c )
+//  void uart_puts( const char *s )
+//  void uart_putu( uint32_t value )
+//  Send a character, a string, or an unsigned number in decimal.
+//  ------------------------------------------------------------------------------------------
+void uart_putc( char c );
+void uart_puts( const char *s );
+void uart_putu( uint32_t value );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void uart_close( void )
+//  Waits until everything has been sent and switches USART1 off.
+//  ------------------------------------------------------------------------------------------
+void uart_close( void );
+
+#endif // __UART_H
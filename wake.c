@@ -0,0 +1,156 @@
+//  ==========================================================================================
+//  wake.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See wake.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "wake.h"
+
+#define WAKE_POST_SYSTICK   0x01
+#define WAKE_POST_MAIN      0x02
+
+uint16_t wake_count[ WAKE_SOURCES ];
+uint16_t wake_spurious[ WAKE_SOURCES ];
+uint16_t wake_unknown;
+uint32_t wake_masked;
+uint32_t wake_lastIspr;
+uint32_t wake_lastExti;
+
+static uint32_t          wake_maskable;
+static uint8_t           wake_lastSysTick;          // SysTick pending at the last wake
+static uint8_t           wake_run[ WAKE_SOURCES ];  // Spurious wakes in a row
+static volatile uint32_t wake_postedIrq;            // Interrupts that posted work
+static volatile uint8_t  wake_postedOther;          // SysTick or main loop posted work
+
+
+//  ------------------------------------------------------------------------------------------
+//  wake_init
+//  ------------------------------------------------------------------------------------------
+void
+wake_init( uint32_t maskable )
+{
+  wake_maskable = maskable;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wake_post
+//  ------------------------------------------------------------------------------------------
+// IPSR holds the exception number of the running handler: 0 in the main loop, 15 for
+// SysTick and 16 + IRQn for interrupts. A handler of higher priority can interrupt the
+// read-modify-write, so it is done with interrupts disabled.
+void
+wake_post( void )
+{
+  uint32_t ipsr    = __get_IPSR();
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  if( ipsr >= 16 )
+    wake_postedIrq   |= 1UL << ( ipsr - 16 );
+  else if( ipsr == 15 )
+    wake_postedOther |= WAKE_POST_SYSTICK;
+  else if( ipsr == 0 )
+    wake_postedOther |= WAKE_POST_MAIN;
+
+  __set_PRIMASK( primask );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wake_account
+//  ------------------------------------------------------------------------------------------
+// Counts one wake of a source, and disables the source if it is maskable and has now woken
+// the chip WAKE_LIMIT times in a row without doing any work.
+static void
+wake_account( uint8_t source, uint8_t useful )
+{
+  wake_count[ source ]++;
+  if( useful )
+  {
+    wake_run[ source ] = 0;
+    return;
+  }
+
+  wake_spurious[ source ]++;
+  if( ++wake_run[ source ] < WAKE_LIMIT || source == WAKE_SYSTICK ||
+      !( wake_maskable & ( 1UL << source ) ) )
+    return;
+
+  NVIC_DisableIRQ( (IRQn_Type)source );
+  wake_masked |= 1UL << source;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wake_tally
+//  ------------------------------------------------------------------------------------------
+// Accounts for the previous wake, once the main loop has also finished with it. Called
+// with interrupts disabled.
+static void
+wake_tally( void )
+{
+  uint32_t posted = wake_postedIrq;
+
+  if( !wake_lastIspr && !wake_lastSysTick )
+    return;
+
+  if( wake_postedOther & WAKE_POST_MAIN )
+    posted = 0xFFFFFFFF;
+
+  for( uint8_t x=0; x<32; x++ )
+    if( wake_lastIspr & ( 1UL << x ) )
+      wake_account( x, ( posted >> x ) & 1 );
+  if( wake_lastSysTick )
+    wake_account( WAKE_SYSTICK, wake_postedOther != 0 );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wake_sleep
+//  ------------------------------------------------------------------------------------------
+// With PRIMASK set, WFI still returns as soon as an enabled interrupt is pending, but the
+// handler only runs once interrupts are enabled again. Only interrupts that are enabled in
+// the NVIC can wake the chip, so pending bits of disabled ones are ignored.
+void
+wake_sleep( void )
+{
+  __disable_irq();
+  wake_tally();
+  wake_postedIrq   = 0;
+  wake_postedOther = 0;
+
+  __WFI();
+
+  wake_lastIspr    = NVIC->ISPR[0] & NVIC->ISER[0];
+  wake_lastSysTick = ( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk ) ? 1 : 0;
+  wake_lastExti    = EXTI->PR;
+  if( !wake_lastIspr && !wake_lastSysTick )
+    wake_unknown++;
+
+  __enable_irq();                           // The pending handlers run here
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wake_unmask
+//  ------------------------------------------------------------------------------------------
+void
+wake_unmask( uint32_t irqs )
+{
+  irqs &= wake_masked;
+  wake_masked &= ~irqs;
+
+  for( uint8_t x=0; x<32; x++ )
+    if( irqs & ( 1UL << x ) )
+    {
+      wake_run[x] = 0;
+      NVIC_ClearPendingIRQ( (IRQn_Type)x );
+      NVIC_EnableIRQ( (IRQn_Type)x );
+    }
+}
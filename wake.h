@@ -0,0 +1,88 @@
+//  ==========================================================================================
+//  wake.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Finds out what woke the chip, and whether waking up was worth it.
+//
+//  In Sleep mode, pretty much any interrupt wakes the chip, and some of them do no real
+//  work, e.g. a timer overflow that only extends a count, or an EXTI line bouncing after
+//  the button has already been handled. Each of these wakes costs power, but nothing shows
+//  which wakes they were. Here the sleep is entered with interrupts disabled (PRIMASK set):
+//    * A pending interrupt still ends the WFI, but its handler does not run yet. The NVIC
+//      pending bits, the SysTick pending bit and EXTI->PR are read at this point, so each
+//      wake is attributed to the interrupts that caused it.
+//    * Interrupts are then enabled and the pending handlers run as usual. A handler that
+//      did real work calls wake_post(), which marks its own interrupt (found from the IPSR
+//      register) as useful. A call from the main loop marks the whole wake as useful.
+//    * Each source that woke the chip without posting is counted as a spurious wake. This
+//      is done at the next wake_sleep(), so that work done by the main loop after waking up
+//      is also included.
+//    * Optionally, a source that wakes the chip WAKE_LIMIT times in a row without doing any
+//      work is disabled in the NVIC, e.g. a noisy input that is not connected. Only the
+//      interrupts given in the mask to wake_init() are ever disabled.
+//
+//  The timers each have their own interrupt on this chip (except TIM1, which has two), so
+//  the NVIC pending bit identifies the timer. The EXTI lines share three interrupts, so
+//  EXTI->PR at the wake is kept in wake_lastExti.
+//
+//  Sources are numbered by IRQn (0 to 31), with SysTick as WAKE_SYSTICK. SysTick is never
+//  disabled.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __WAKE_H
+#define __WAKE_H
+
+#include "stm32f030x6.h"
+
+#define WAKE_SYSTICK    32          // Source number of SysTick
+#define WAKE_SOURCES    33
+
+#ifndef WAKE_LIMIT
+#define WAKE_LIMIT      16          // Spurious wakes in a row before a source is disabled
+#endif
+
+extern uint16_t wake_count[ WAKE_SOURCES ];     // Wakes caused by each source
+extern uint16_t wake_spurious[ WAKE_SOURCES ];  // ... of which did no work
+extern uint16_t wake_unknown;       // Wakes with no interrupt pending (e.g. an event)
+extern uint32_t wake_masked;        // Interrupts disabled for waking up without work
+extern uint32_t wake_lastIspr;      // NVIC pending bits at the last wake
+extern uint32_t wake_lastExti;      // EXTI->PR at the last wake
+
+
+//  ------------------------------------------------------------------------------------------
+//  void wake_init( uint32_t maskable )
+//  maskable has bit n set for each IRQn that may be disabled after WAKE_LIMIT spurious
+//  wakes in a row. 0 only counts the wakes.
+//  ------------------------------------------------------------------------------------------
+void wake_init( uint32_t maskable );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void wake_sleep( void )
+//  Use in place of __WFI() in the main loop. Updates the counters for the previous wake,
+//  sleeps in the mode set up in SCB->SCR and PWR->CR, and runs the handlers that woke the
+//  chip.
+//  ------------------------------------------------------------------------------------------
+void wake_sleep( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void wake_post( void )
+//  Call when real work has been done. From a handler, marks that interrupt as useful for
+//  the current wake. From the main loop, marks every source of the current wake as useful.
+//  ------------------------------------------------------------------------------------------
+void wake_post( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void wake_unmask( uint32_t irqs )
+//  Enables the given interrupts (bit n = IRQn) again after they were disabled for waking
+//  up without work, and restarts their counts of spurious wakes in a row.
+//  ------------------------------------------------------------------------------------------
+void wake_unmask( uint32_t irqs );
+
+#endif // __WAKE_H
@@ -0,0 +1,211 @@
+//  ==========================================================================================
+//  wheel.c for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  See wheel.h for details.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#include "wheel.h"
+#include "tconv.h"
+
+static struct
+{
+  uint32_t   due;                           // wheel_now() value when next due
+  uint32_t   period;                        // 0 for a one-shot timer
+  wheel_fn_t fn;                            // 0 when the timer is not active
+} wheel_timers[ WHEEL_TIMERS ];
+
+static volatile uint32_t wheel_high;        // Counter overflows, i.e. bits 16-31 of the time
+
+
+//  ------------------------------------------------------------------------------------------
+//  wheel_init
+//  ------------------------------------------------------------------------------------------
+void
+wheel_init( void )
+{
+  RCC->APB2ENR |= RCC_APB2ENR_TIM17EN;
+
+  TIM17->CR1   = TIM_CR1_URS;
+  TIM17->PSC   = tconv_psc1kHz;
+  TIM17->ARR   = 0xFFFF;
+  TIM17->CCMR1 = 0;                         // Channel 1 as compare, output frozen
+  TIM17->EGR   = TIM_EGR_UG;                // Load the prescaler
+  TIM17->SR    = 0;
+  TIM17->DIER  = TIM_DIER_UIE;
+  TIM17->CR1  |= TIM_CR1_CEN;
+
+  NVIC_EnableIRQ( TIM17_IRQn );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wheel_retime
+//  ------------------------------------------------------------------------------------------
+// The prescaler is only loaded on an update event, and UG also clears the counter, so the
+// time is saved first and written back afterwards. Called from clockChanged(), which may
+// run inside RCC_IRQHandler or NMI_Handler, so PRIMASK is restored rather than cleared.
+void
+wheel_retime( void )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint32_t now = wheel_now();
+  TIM17->PSC = tconv_psc1kHz;
+  TIM17->EGR = TIM_EGR_UG;
+  TIM17->CNT = now & 0xFFFF;
+  wheel_high = now >> 16;
+  TIM17->SR  = (uint32_t)~TIM_SR_UIF;
+
+  __set_PRIMASK( primask );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wheel_now
+//  ------------------------------------------------------------------------------------------
+// If an overflow is pending but not handled yet, a small counter value means the counter
+// has already wrapped. The read is repeated if the interrupt ran in between.
+uint32_t
+wheel_now( void )
+{
+  uint32_t high, count, overflow;
+
+  do
+  {
+    high     = wheel_high;
+    count    = TIM17->CNT;
+    overflow = TIM17->SR & TIM_SR_UIF;
+  } while( high != wheel_high );
+
+  if( overflow && count < 0x8000 )
+    high++;
+  return (high << 16) | count;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wheel_rearm
+//  ------------------------------------------------------------------------------------------
+// Sets compare channel 1 to the earliest due time. If that is more than one counter wrap
+// away, the compare is left off and the next overflow interrupt calls this again. If it
+// is already due (or becomes due while being set up), the compare event is forced.
+static void
+wheel_rearm( void )
+{
+  uint8_t  found = 0;
+  int32_t  next  = 0;
+  uint32_t now   = wheel_now();
+
+  for( uint8_t x=0; x<WHEEL_TIMERS; x++ )
+    if( wheel_timers[x].fn )
+    {
+      int32_t left = (int32_t)( wheel_timers[x].due - now );
+      if( !found || left < next )
+        next = left;
+      found = 1;
+    }
+
+  if( !found || next > 0xFFFF )
+  {
+    TIM17->DIER &= ~TIM_DIER_CC1IE;
+    return;
+  }
+
+  TIM17->CCR1  = (uint16_t)( now + next );
+  TIM17->SR    = (uint32_t)~TIM_SR_CC1IF;
+  TIM17->DIER |= TIM_DIER_CC1IE;
+  if( (int32_t)( now + next - wheel_now() ) <= 0 )
+    TIM17->EGR = TIM_EGR_CC1G;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wheel_start
+//  ------------------------------------------------------------------------------------------
+void
+wheel_start( uint8_t id, uint32_t delayMs, uint32_t periodMs, wheel_fn_t fn )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  wheel_timers[id].due    = wheel_now() + delayMs;
+  wheel_timers[id].period = periodMs;
+  wheel_timers[id].fn     = fn;
+  wheel_rearm();
+
+  __set_PRIMASK( primask );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wheel_stop
+//  ------------------------------------------------------------------------------------------
+void
+wheel_stop( uint8_t id )
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  wheel_timers[id].fn = 0;
+  wheel_rearm();
+
+  __set_PRIMASK( primask );
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wheel_pending
+//  ------------------------------------------------------------------------------------------
+uint8_t
+wheel_pending( void )
+{
+  for( uint8_t x=0; x<WHEEL_TIMERS; x++ )
+    if( wheel_timers[x].fn )
+      return 1;
+  return 0;
+}
+
+
+//  ------------------------------------------------------------------------------------------
+//  wheel_irq
+//  ------------------------------------------------------------------------------------------
+// A timer function may start or stop timers (including its own), so each timer is checked
+// for being active again after every call.
+uint8_t
+wheel_irq( void )
+{
+  uint8_t  calls = 0;
+  uint32_t sr    = TIM17->SR;
+
+  if( sr & TIM_SR_UIF )
+  {
+    TIM17->SR = (uint32_t)~TIM_SR_UIF;
+    wheel_high++;
+  }
+  if( sr & TIM_SR_CC1IF )
+    TIM17->SR = (uint32_t)~TIM_SR_CC1IF;
+
+  uint32_t now = wheel_now();
+  for( uint8_t x=0; x<WHEEL_TIMERS; x++ )
+  {
+    wheel_fn_t fn = wheel_timers[x].fn;
+    if( fn && (int32_t)( now - wheel_timers[x].due ) >= 0 )
+    {
+      if( wheel_timers[x].period )
+        wheel_timers[x].due += wheel_timers[x].period;
+      else
+        wheel_timers[x].fn = 0;
+      fn();
+      calls++;
+    }
+  }
+
+  wheel_rearm();
+  return calls;
+}
@@ -0,0 +1,96 @@
+//  ==========================================================================================
+//  wheel.h for STM32F030-CMSIS-Sleep-and-Wake-Example
+//  ------------------------------------------------------------------------------------------
+//  Millisecond time base and software timers on TIM17.
+//
+//  TIM17 runs continuously with a 1 ms tick. Its 16-bit counter overflows every 65.5 s,
+//  which is the only regular interrupt; the overflows are counted to provide a 32-bit
+//  millisecond clock, wheel_now(), that does not wrap for 49 days.
+//
+//  On top of this, a small fixed table of software timers can call a function after a delay
+//  and optionally repeat it. There is no periodic tick: compare channel 1 is set to the
+//  time of the next timer that is due, so the CPU is only woken when something actually
+//  needs to be done. When no timers are active, the compare interrupt is disabled.
+//
+//  Each user of a timer has its own slot, listed below as WHEEL_ID_xxx. The timer functions
+//  are called from TIM17_IRQHandler, which must call wheel_irq().
+//
+//  Timers do not run in Stop mode, so the time base and timers only advance in Run and
+//  Sleep mode.
+//  ------------------------------------------------------------------------------------------
+//  https://github.com/EZdenki/STM32F030-CMSIS-Sleep-and-Wake-Example
+//  Released under the MIT License
+//  Copyright (c) 2023
+//  Mike Shegedin, EZdenki.com
+//  ==========================================================================================
+
+#ifndef __WHEEL_H
+#define __WHEEL_H
+
+#include "stm32f030x6.h"
+
+// Timer slots
+#define WHEEL_ID_DEBOUNCE   0
+#define WHEEL_ID_KEYPAD     1
+#define WHEEL_ID_TOUCH      2
+#define WHEEL_ID_LOAD       3
+#define WHEEL_ID_SCAN       4
+#define WHEEL_ID_TELEM      5
+#define WHEEL_ID_SCHED      6
+#define WHEEL_TIMERS        7
+
+typedef void (*wheel_fn_t)( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void wheel_init( void )
+//  Starts TIM17 as the millisecond time base and enables its interrupt.
+//  ------------------------------------------------------------------------------------------
+void wheel_init( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void wheel_retime( void )
+//  Call after the timer clock has changed. Reloads the prescaler without losing the time.
+//  ------------------------------------------------------------------------------------------
+void wheel_retime( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint32_t wheel_now( void )
+//  Returns the number of milliseconds since wheel_init().
+//  ------------------------------------------------------------------------------------------
+uint32_t wheel_now( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void wheel_start( uint8_t id, uint32_t delayMs, uint32_t periodMs, wheel_fn_t fn )
+//  Calls fn (from the TIM17 interrupt) delayMs from now, and then every periodMs if
+//  periodMs is not 0. Restarts the timer if it was already running.
+//  ------------------------------------------------------------------------------------------
+void wheel_start( uint8_t id, uint32_t delayMs, uint32_t periodMs, wheel_fn_t fn );
+
+
+//  ------------------------------------------------------------------------------------------
+//  void wheel_stop( uint8_t id )
+//  Stops the timer. May be called from the timer's own function.
+//  ------------------------------------------------------------------------------------------
+void wheel_stop( uint8_t id );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t wheel_pending( void )
+//  Returns 1 if any timer is running. Stop mode would halt TIM17, so the main loop should
+//  only enter Stop mode while this returns 0, and use Sleep mode otherwise.
+//  ------------------------------------------------------------------------------------------
+uint8_t wheel_pending( void );
+
+
+//  ------------------------------------------------------------------------------------------
+//  uint8_t wheel_irq( void )
+//  Call from TIM17_IRQHandler. Returns the number of timer functions called, which is 0
+//  when the interrupt only extended the time base.
+//  ------------------------------------------------------------------------------------------
+uint8_t wheel_irq( void );
+
+#endif // __WHEEL_H